@@ -26,6 +26,14 @@
  */
 
 #include <cg.h>
+#include <pthread.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CG_SIMD_X86
+#define CG_TARGET_SSE2		__attribute__((target("sse2")))
+#define CG_TARGET_AVX2		__attribute__((target("avx2")))
+#endif
 
 #define cg_array_init(array) \
 	do { \
@@ -214,6 +222,7 @@ struct cg_surface_t * cg_surface_create(int width, int height)
 	surface->stride = width << 2;
 	surface->owndata = 1;
 	surface->pixels = calloc(1, (size_t)(height * surface->stride));
+	surface->generation = 0;
 	return surface;
 }
 
@@ -226,6 +235,7 @@ struct cg_surface_t * cg_surface_create_for_data(int width, int height, void * p
 	surface->stride = width << 2;
 	surface->owndata = 0;
 	surface->pixels = pixels;
+	surface->generation = 0;
 	return surface;
 }
 
@@ -252,6 +262,11 @@ struct cg_surface_t * cg_surface_reference(struct cg_surface_t * surface)
 	return NULL;
 }
 
+void cg_surface_mark_dirty(struct cg_surface_t * surface)
+{
+	surface->generation++;
+}
+
 struct cg_path_t * cg_path_create(void)
 {
 	struct cg_path_t * path = malloc(sizeof(struct cg_path_t));
@@ -524,81 +539,59 @@ static inline void cg_path_clear(struct cg_path_t * path)
 	path->start.y = 0.0;
 }
 
-struct cg_bezier_t {
-	double x1; double y1;
-	double x2; double y2;
-	double x3; double y3;
-	double x4; double y4;
-};
-
-static inline void split(struct cg_bezier_t * b, struct cg_bezier_t * first, struct cg_bezier_t * second)
-{
-	double c = (b->x2 + b->x3) * 0.5;
-	first->x2 = (b->x1 + b->x2) * 0.5;
-	second->x3 = (b->x3 + b->x4) * 0.5;
-	first->x1 = b->x1;
-	second->x4 = b->x4;
-	first->x3 = (first->x2 + c) * 0.5;
-	second->x2 = (second->x3 + c) * 0.5;
-	first->x4 = second->x1 = (first->x3 + second->x2) * 0.5;
-
-	c = (b->y2 + b->y3) * 0.5;
-	first->y2 = (b->y1 + b->y2) * 0.5;
-	second->y3 = (b->y3 + b->y4) * 0.5;
-	first->y1 = b->y1;
-	second->y4 = b->y4;
-	first->y3 = (first->y2 + c) * 0.5;
-	second->y2 = (second->y3 + c) * 0.5;
-	first->y4 = second->y1 = (first->y3 + second->y2) * 0.5;
-}
-
-static inline void flatten(struct cg_path_t * path, struct cg_point_t * p0, struct cg_point_t * p1, struct cg_point_t * p2, struct cg_point_t * p3)
-{
-	struct cg_bezier_t beziers[32];
-	struct cg_bezier_t * b = beziers;
-
-	beziers[0].x1 = p0->x;
-	beziers[0].y1 = p0->y;
-	beziers[0].x2 = p1->x;
-	beziers[0].y2 = p1->y;
-	beziers[0].x3 = p2->x;
-	beziers[0].y3 = p2->y;
-	beziers[0].x4 = p3->x;
-	beziers[0].y4 = p3->y;
-	while(b >= beziers)
-	{
-		double y4y1 = b->y4 - b->y1;
-		double x4x1 = b->x4 - b->x1;
-		double l = fabs(x4x1) + fabs(y4y1);
-		double d;
-		if(l > 1.0)
-		{
-			d = fabs((x4x1) * (b->y1 - b->y2) - (y4y1) * (b->x1 - b->x2)) + fabs((x4x1) * (b->y1 - b->y3) - (y4y1) * (b->x1 - b->x3));
-		}
-		else
-		{
-			d = fabs(b->x1 - b->x2) + fabs(b->y1 - b->y2) + fabs(b->x1 - b->x3) + fabs(b->y1 - b->y3);
-			l = 1.0;
-		}
-		if((d < l * 0.25) || (b == beziers + 31))
-		{
-			cg_path_line_to(path, b->x4, b->y4);
-			--b;
-		}
-		else
-		{
-			split(b, b + 1, b);
-			++b;
-		}
+static inline int cg_bezier_segments(struct cg_matrix_t * m, double tolerance, struct cg_point_t * p0, struct cg_point_t * p1, struct cg_point_t * p2, struct cg_point_t * p3)
+{
+	double ax = p0->x - 2 * p1->x + p2->x;
+	double ay = p0->y - 2 * p1->y + p2->y;
+	double bx = p1->x - 2 * p2->x + p3->x;
+	double by = p1->y - 2 * p2->y + p3->y;
+	double ux = m->a * ax + m->c * ay;
+	double uy = m->b * ax + m->d * ay;
+	double vx = m->a * bx + m->c * by;
+	double vy = m->b * bx + m->d * by;
+	double dd = fmax(ux * ux + uy * uy, vx * vx + vy * vy);
+	return (int)CG_CLAMP(ceil(sqrt(0.75 * sqrt(dd) / tolerance)), 1.0, 1024.0);
+}
+
+static inline void flatten(struct cg_path_t * path, struct cg_matrix_t * m, double tolerance, struct cg_point_t * p0, struct cg_point_t * p1, struct cg_point_t * p2, struct cg_point_t * p3)
+{
+	int n = cg_bezier_segments(m, tolerance, p0, p1, p2, p3);
+	double ax = p0->x - 2 * p1->x + p2->x;
+	double ay = p0->y - 2 * p1->y + p2->y;
+	double bx = p1->x - 2 * p2->x + p3->x;
+	double by = p1->y - 2 * p2->y + p3->y;
+	double t = 1.0 / n;
+	double t2 = t * t;
+	double t3 = t2 * t;
+	double cx = 3 * (p1->x - p0->x);
+	double cy = 3 * (p1->y - p0->y);
+	double x = p0->x;
+	double y = p0->y;
+	double fx = (bx - ax) * t3 + 3 * ax * t2 + cx * t;
+	double fy = (by - ay) * t3 + 3 * ay * t2 + cy * t;
+	double ffx = 6 * (bx - ax) * t3 + 6 * ax * t2;
+	double ffy = 6 * (by - ay) * t3 + 6 * ay * t2;
+	double fffx = 6 * (bx - ax) * t3;
+	double fffy = 6 * (by - ay) * t3;
+	for(int i = 1; i < n; i++)
+	{
+		x += fx;
+		y += fy;
+		fx += ffx;
+		fy += ffy;
+		ffx += fffx;
+		ffy += fffy;
+		cg_path_line_to(path, x, y);
 	}
+	cg_path_line_to(path, p3->x, p3->y);
 }
 
-static inline struct cg_path_t * cg_path_clone_flat(struct cg_path_t * path)
+static inline struct cg_path_t * cg_path_clone_flat(struct cg_path_t * result, struct cg_path_t * path, struct cg_matrix_t * m, double tolerance)
 {
 	struct cg_point_t * points = path->points.data;
-	struct cg_path_t * result = cg_path_create();
 	struct cg_point_t p0;
 
+	cg_path_clear(result);
 	cg_array_ensure(result->elements, path->elements.size);
 	cg_array_ensure(result->points, path->points.size);
 	for(int i = 0; i < path->elements.size; i++)
@@ -615,11 +608,11 @@ static inline struct cg_path_t * cg_path_clone_flat(struct cg_path_t * path)
 			break;
 		case CG_PATH_ELEMENT_CURVE_TO:
 			cg_path_get_current_point(result, &p0.x, &p0.y);
-			flatten(result, &p0, points, points + 1, points + 2);
+			flatten(result, m, tolerance, &p0, points, points + 1, points + 2);
 			points += 3;
 			break;
 		case CG_PATH_ELEMENT_CLOSE:
-			cg_path_line_to(result, points[0].x, points[0].y);
+			cg_path_close(result);
 			points += 1;
 			break;
 		default:
@@ -634,6 +627,7 @@ static struct cg_dash_t * cg_dash_create(double * dashes, int ndash, double offs
 	if(dashes && (ndash > 0))
 	{
 		struct cg_dash_t * dash = malloc(sizeof(struct cg_dash_t));
+		dash->ref = 1;
 		dash->offset = offset;
 		dash->data = malloc((size_t)ndash * sizeof(double));
 		dash->size = ndash;
@@ -643,10 +637,13 @@ static struct cg_dash_t * cg_dash_create(double * dashes, int ndash, double offs
 	return NULL;
 }
 
-static struct cg_dash_t * cg_dash_clone(struct cg_dash_t * dash)
+static struct cg_dash_t * cg_dash_reference(struct cg_dash_t * dash)
 {
 	if(dash)
-		return cg_dash_create(dash->data, dash->size, dash->offset);
+	{
+		++dash->ref;
+		return dash;
+	}
 	return NULL;
 }
 
@@ -654,18 +651,68 @@ static void cg_dash_destroy(struct cg_dash_t * dash)
 {
 	if(dash)
 	{
-		free(dash->data);
-		free(dash);
+		if(--dash->ref == 0)
+		{
+			free(dash->data);
+			free(dash);
+		}
 	}
 }
 
-static inline struct cg_path_t * cg_dash_path(struct cg_dash_t * dash, struct cg_path_t * path)
+struct cg_dasher_t {
+	struct cg_dash_t * dash;
+	struct cg_matrix_t * m;
+	double tolerance;
+	int toggle;
+	int offset;
+	double phase;
+	int start_toggle;
+	int start_offset;
+	double start_phase;
+	struct cg_point_t current;
+	void (*move_to)(struct cg_dasher_t * dasher, struct cg_point_t * p);
+	void (*line_to)(struct cg_dasher_t * dasher, struct cg_point_t * p);
+	void (*curve_to)(struct cg_dasher_t * dasher, struct cg_point_t * p);
+	void * user;
+};
+
+static inline void cg_bezier_point(struct cg_point_t * p, double t, struct cg_point_t * r)
+{
+	double u = 1 - t;
+	double a = u * u * u;
+	double b = 3 * u * u * t;
+	double c = 3 * u * t * t;
+	double d = t * t * t;
+	r->x = a * p[0].x + b * p[1].x + c * p[2].x + d * p[3].x;
+	r->y = a * p[0].y + b * p[1].y + c * p[2].y + d * p[3].y;
+}
+
+static inline void cg_bezier_tangent(struct cg_point_t * p, double t, struct cg_point_t * r)
+{
+	double u = 1 - t;
+	double a = 3 * u * u;
+	double b = 6 * u * t;
+	double c = 3 * t * t;
+	r->x = a * (p[1].x - p[0].x) + b * (p[2].x - p[1].x) + c * (p[3].x - p[2].x);
+	r->y = a * (p[1].y - p[0].y) + b * (p[2].y - p[1].y) + c * (p[3].y - p[2].y);
+}
+
+static inline void cg_bezier_segment(struct cg_point_t * p, double t0, double t1, struct cg_point_t * r)
 {
-	struct cg_path_t * flat = cg_path_clone_flat(path);
-	struct cg_path_t * result = cg_path_create();
-	cg_array_ensure(result->elements, flat->elements.size);
-	cg_array_ensure(result->points, flat->points.size);
+	struct cg_point_t d0, d1;
+	double k = (t1 - t0) / 3;
+	cg_bezier_point(p, t0, &r[0]);
+	cg_bezier_point(p, t1, &r[3]);
+	cg_bezier_tangent(p, t0, &d0);
+	cg_bezier_tangent(p, t1, &d1);
+	r[1].x = r[0].x + k * d0.x;
+	r[1].y = r[0].y + k * d0.y;
+	r[2].x = r[3].x - k * d1.x;
+	r[2].y = r[3].y - k * d1.y;
+}
 
+static void cg_dasher_init(struct cg_dasher_t * dasher, struct cg_dash_t * dash, struct cg_matrix_t * m, double tolerance)
+{
 	int toggle = 1;
 	int offset = 0;
 	double phase = dash->offset;
@@ -677,74 +724,261 @@ static inline struct cg_path_t * cg_dash_path(struct cg_dash_t * dash, struct cg
 		if(offset == dash->size)
 			offset = 0;
 	}
-	enum cg_path_element_t * elements = flat->elements.data;
-	enum cg_path_element_t * end = elements + flat->elements.size;
-	struct cg_point_t * points = flat->points.data;
-	while(elements < end)
-	{
-		int itoggle = toggle;
-		int ioffset = offset;
-		double iphase = phase;
-		double x0 = points->x;
-		double y0 = points->y;
-		if(itoggle)
-			cg_path_move_to(result, x0, y0);
-		++elements;
-		++points;
-		while((elements < end) && (*elements == CG_PATH_ELEMENT_LINE_TO))
-		{
-			double dx = points->x - x0;
-			double dy = points->y - y0;
-			double dist0 = sqrt(dx * dx + dy * dy);
-			double dist1 = 0;
-			while(dist0 - dist1 > dash->data[ioffset] - iphase)
+	dasher->dash = dash;
+	dasher->m = m;
+	dasher->tolerance = tolerance;
+	dasher->toggle = dasher->start_toggle = toggle;
+	dasher->offset = dasher->start_offset = offset;
+	dasher->phase = dasher->start_phase = phase;
+	dasher->current.x = 0;
+	dasher->current.y = 0;
+}
+
+static inline int cg_dasher_advance(struct cg_dasher_t * dasher, double dist0, double * dist1)
+{
+	double left = dasher->dash->data[dasher->offset] - dasher->phase;
+	if(dist0 - *dist1 > left)
+	{
+		*dist1 += left;
+		dasher->toggle = !dasher->toggle;
+		dasher->phase = 0;
+		dasher->offset += 1;
+		if(dasher->offset == dasher->dash->size)
+			dasher->offset = 0;
+		return 1;
+	}
+	dasher->phase += dist0 - *dist1;
+	return 0;
+}
+
+static void cg_dasher_move_to(struct cg_dasher_t * dasher, struct cg_point_t * p)
+{
+	dasher->toggle = dasher->start_toggle;
+	dasher->offset = dasher->start_offset;
+	dasher->phase = dasher->start_phase;
+	dasher->current = *p;
+	if(dasher->toggle)
+		dasher->move_to(dasher, p);
+}
+
+static void cg_dasher_line_to(struct cg_dasher_t * dasher, struct cg_point_t * p)
+{
+	double dx = p->x - dasher->current.x;
+	double dy = p->y - dasher->current.y;
+	double dist0 = sqrt(dx * dx + dy * dy);
+	double dist1 = 0;
+	while(cg_dasher_advance(dasher, dist0, &dist1))
+	{
+		double a = dist1 / dist0;
+		struct cg_point_t q = { dasher->current.x + a * dx, dasher->current.y + a * dy };
+		if(dasher->toggle)
+			dasher->move_to(dasher, &q);
+		else
+			dasher->line_to(dasher, &q);
+	}
+	if(dasher->toggle)
+		dasher->line_to(dasher, p);
+	dasher->current = *p;
+}
+
+static inline void cg_dasher_emit(struct cg_dasher_t * dasher, struct cg_point_t * r)
+{
+	if(cg_bezier_segments(dasher->m, dasher->tolerance, &r[0], &r[1], &r[2], &r[3]) == 1)
+		dasher->line_to(dasher, &r[3]);
+	else
+		dasher->curve_to(dasher, r);
+}
+
+static void cg_dasher_curve_to(struct cg_dasher_t * dasher, struct cg_point_t * p1, struct cg_point_t * p2, struct cg_point_t * p3)
+{
+	struct cg_point_t p[4] = { dasher->current, *p1, *p2, *p3 };
+	struct cg_point_t r[4];
+	struct cg_point_t a = p[0];
+	struct cg_point_t b;
+	int n = cg_bezier_segments(dasher->m, dasher->tolerance, &p[0], &p[1], &p[2], &p[3]);
+	double t0 = 0;
+	int i0 = 1;
+	for(int i = 1; i <= n; i++)
+	{
+		double ta = (double)(i - 1) / n;
+		double tb = (double)i / n;
+		cg_bezier_point(p, tb, &b);
+		double dx = b.x - a.x;
+		double dy = b.y - a.y;
+		double dist0 = sqrt(dx * dx + dy * dy);
+		double dist1 = 0;
+		while(cg_dasher_advance(dasher, dist0, &dist1))
+		{
+			double t = ta + (tb - ta) * dist1 / dist0;
+			if(dasher->toggle)
 			{
-				dist1 += dash->data[ioffset] - iphase;
-				double a = dist1 / dist0;
-				double x = x0 + a * dx;
-				double y = y0 + a * dy;
-				if(itoggle)
-					cg_path_line_to(result, x, y);
-				else
-					cg_path_move_to(result, x, y);
-				itoggle = !itoggle;
-				iphase = 0;
-				ioffset += 1;
-				if(ioffset == dash->size)
-					ioffset = 0;
+				cg_bezier_point(p, t, &r[0]);
+				dasher->move_to(dasher, &r[0]);
+			}
+			else if(i == i0)
+			{
+				cg_bezier_point(p, t, &r[3]);
+				dasher->line_to(dasher, &r[3]);
 			}
-			iphase += dist0 - dist1;
-			x0 = points->x;
-			y0 = points->y;
-			if(itoggle)
-				cg_path_line_to(result, x0, y0);
-			++elements;
-			++points;
+			else
+			{
+				cg_bezier_segment(p, t0, t, r);
+				cg_dasher_emit(dasher, r);
+			}
+			t0 = t;
+			i0 = i;
+		}
+		a = b;
+	}
+	if(dasher->toggle)
+	{
+		if(i0 == n)
+		{
+			dasher->line_to(dasher, p3);
+		}
+		else
+		{
+			cg_bezier_segment(p, t0, 1, r);
+			r[3] = *p3;
+			cg_dasher_emit(dasher, r);
+		}
+	}
+	dasher->current = *p3;
+}
+
+static void cg_dasher_path(struct cg_dasher_t * dasher, struct cg_path_t * path)
+{
+	enum cg_path_element_t * elements = path->elements.data;
+	struct cg_point_t * points = path->points.data;
+	for(int i = 0; i < path->elements.size; i++)
+	{
+		switch(elements[i])
+		{
+		case CG_PATH_ELEMENT_MOVE_TO:
+			cg_dasher_move_to(dasher, points);
+			points += 1;
+			break;
+		case CG_PATH_ELEMENT_LINE_TO:
+		case CG_PATH_ELEMENT_CLOSE:
+			cg_dasher_line_to(dasher, points);
+			points += 1;
+			break;
+		case CG_PATH_ELEMENT_CURVE_TO:
+			cg_dasher_curve_to(dasher, points, points + 1, points + 2);
+			points += 3;
+			break;
+		default:
+			break;
 		}
 	}
-	cg_path_destroy(flat);
+}
+
+static void cg_dash_path_move_to(struct cg_dasher_t * dasher, struct cg_point_t * p)
+{
+	cg_path_move_to(dasher->user, p->x, p->y);
+}
+
+static void cg_dash_path_line_to(struct cg_dasher_t * dasher, struct cg_point_t * p)
+{
+	cg_path_line_to(dasher->user, p->x, p->y);
+}
+
+static void cg_dash_path_curve_to(struct cg_dasher_t * dasher, struct cg_point_t * p)
+{
+	flatten(dasher->user, dasher->m, dasher->tolerance, &p[0], &p[1], &p[2], &p[3]);
+}
+
+static inline struct cg_path_t * cg_dash_path(struct cg_path_t * result, struct cg_dash_t * dash, struct cg_path_t * path, struct cg_matrix_t * m, double tolerance)
+{
+	struct cg_dasher_t dasher;
+	cg_path_clear(result);
+	cg_dasher_init(&dasher, dash, m, tolerance);
+	dasher.move_to = cg_dash_path_move_to;
+	dasher.line_to = cg_dash_path_line_to;
+	dasher.curve_to = cg_dash_path_curve_to;
+	dasher.user = result;
+	cg_dasher_path(&dasher, path);
 	return result;
 }
 
+struct sw_ft_outline_buffer_t {
+	SW_FT_Outline ft;
+	int points;
+	int contours;
+};
+
+static SW_FT_Outline * sw_ft_outline_reset(SW_FT_Outline * ft, int points, int contours)
+{
+	struct sw_ft_outline_buffer_t * buf = (struct sw_ft_outline_buffer_t *)ft;
+	if(!buf)
+	{
+		buf = malloc(sizeof(struct sw_ft_outline_buffer_t));
+		memset(buf, 0, sizeof(struct sw_ft_outline_buffer_t));
+	}
+	if(points + contours > buf->points)
+	{
+		buf->points = CG_MAX(points + contours, buf->points * 2);
+		buf->ft.points = realloc(buf->ft.points, (size_t)buf->points * sizeof(SW_FT_Vector));
+		buf->ft.tags = realloc(buf->ft.tags, (size_t)buf->points * sizeof(char));
+	}
+	if(contours > buf->contours)
+	{
+		buf->contours = CG_MAX(contours, buf->contours * 2);
+		buf->ft.contours = realloc(buf->ft.contours, (size_t)buf->contours * sizeof(int));
+		buf->ft.contours_flag = realloc(buf->ft.contours_flag, (size_t)buf->contours * sizeof(char));
+	}
+	buf->ft.n_points = buf->ft.n_contours = 0;
+	buf->ft.flags = 0x0;
+	return &buf->ft;
+}
+
+static void sw_ft_outline_ensure(SW_FT_Outline * ft, int points, int contours)
+{
+	struct sw_ft_outline_buffer_t * buf = (struct sw_ft_outline_buffer_t *)ft;
+	points += ft->n_points + ft->n_contours + contours + 1;
+	contours += ft->n_contours + 1;
+	if(points > buf->points)
+	{
+		buf->points = CG_MAX(points, buf->points * 2);
+		buf->ft.points = realloc(buf->ft.points, (size_t)buf->points * sizeof(SW_FT_Vector));
+		buf->ft.tags = realloc(buf->ft.tags, (size_t)buf->points * sizeof(char));
+	}
+	if(contours > buf->contours)
+	{
+		buf->contours = CG_MAX(contours, buf->contours * 2);
+		buf->ft.contours = realloc(buf->ft.contours, (size_t)buf->contours * sizeof(int));
+		buf->ft.contours_flag = realloc(buf->ft.contours_flag, (size_t)buf->contours * sizeof(char));
+	}
+}
+
 static SW_FT_Outline * sw_ft_outline_create(int points, int contours)
 {
-	SW_FT_Outline * ft = malloc(sizeof(SW_FT_Outline));
-	ft->points = malloc((size_t)(points + contours) * sizeof(SW_FT_Vector));
-	ft->tags = malloc((size_t)(points + contours) * sizeof(char));
-	ft->contours = malloc((size_t)contours * sizeof(short));
-	ft->contours_flag = malloc((size_t)contours * sizeof(char));
-	ft->n_points = ft->n_contours = 0;
-	ft->flags = 0x0;
+	return sw_ft_outline_reset(NULL, points, contours);
+}
+
+static SW_FT_Outline * sw_ft_outline_copy(SW_FT_Outline * ft, SW_FT_Outline * source)
+{
+	ft = sw_ft_outline_reset(ft, source->n_points, source->n_contours);
+	memcpy(ft->points, source->points, (size_t)source->n_points * sizeof(SW_FT_Vector));
+	memcpy(ft->tags, source->tags, (size_t)source->n_points * sizeof(char));
+	memcpy(ft->contours, source->contours, (size_t)source->n_contours * sizeof(int));
+	memcpy(ft->contours_flag, source->contours_flag, (size_t)source->n_contours * sizeof(char));
+	ft->n_points = source->n_points;
+	ft->n_contours = source->n_contours;
+	ft->flags = source->flags;
 	return ft;
 }
 
 static void sw_ft_outline_destroy(SW_FT_Outline * ft)
 {
-	free(ft->points);
-	free(ft->tags);
-	free(ft->contours);
-	free(ft->contours_flag);
-	free(ft);
+	if(ft)
+	{
+		free(ft->points);
+		free(ft->tags);
+		free(ft->contours);
+		free(ft->contours_flag);
+		free(ft);
+	}
 }
 
 #define FT_COORD(x)	(SW_FT_Pos)((x) * 64)
@@ -810,9 +1044,9 @@ static void sw_ft_outline_end(SW_FT_Outline * ft)
 	}
 }
 
-static SW_FT_Outline * sw_ft_outline_convert(struct cg_path_t * path, struct cg_matrix_t *  m)
+static SW_FT_Outline * sw_ft_outline_convert(SW_FT_Outline * outline, struct cg_path_t * path, struct cg_matrix_t *  m)
 {
-	SW_FT_Outline * outline = sw_ft_outline_create(path->points.size, path->contours);
+	outline = sw_ft_outline_reset(outline, path->points.size, path->contours);
 	enum cg_path_element_t * elements = path->elements.data;
 	struct cg_point_t * points = path->points.data;
 	struct cg_point_t p[3];
@@ -847,11 +1081,200 @@ static SW_FT_Outline * sw_ft_outline_convert(struct cg_path_t * path, struct cg_
 	return outline;
 }
 
-static SW_FT_Outline * sw_ft_outline_convert_dash(struct cg_path_t * path, struct cg_matrix_t * m, struct cg_dash_t * dash)
+struct sw_ft_polygon_buffer_t {
+	SW_FT_Polygon ft;
+	int points;
+	int contours;
+};
+
+static SW_FT_Polygon * sw_ft_polygon_reset(SW_FT_Polygon * ft, int points, int contours)
+{
+	struct sw_ft_polygon_buffer_t * buf = (struct sw_ft_polygon_buffer_t *)ft;
+	if(!buf)
+	{
+		buf = malloc(sizeof(struct sw_ft_polygon_buffer_t));
+		memset(buf, 0, sizeof(struct sw_ft_polygon_buffer_t));
+	}
+	if(points + contours > buf->points)
+	{
+		buf->points = CG_MAX(points + contours, buf->points * 2);
+		buf->ft.points = realloc(buf->ft.points, (size_t)buf->points * sizeof(SW_FT_Point));
+	}
+	if(contours > buf->contours)
+	{
+		buf->contours = CG_MAX(contours, buf->contours * 2);
+		buf->ft.contours = realloc(buf->ft.contours, (size_t)buf->contours * sizeof(int));
+	}
+	buf->ft.n_points = buf->ft.n_contours = 0;
+	buf->ft.flags = 0x0;
+	return &buf->ft;
+}
+
+static SW_FT_Polygon * sw_ft_polygon_create(int points, int contours)
+{
+	return sw_ft_polygon_reset(NULL, points, contours);
+}
+
+static SW_FT_Polygon * sw_ft_polygon_copy(SW_FT_Polygon * ft, SW_FT_Polygon * source)
+{
+	ft = sw_ft_polygon_reset(ft, source->n_points, source->n_contours);
+	memcpy(ft->points, source->points, (size_t)source->n_points * sizeof(SW_FT_Point));
+	memcpy(ft->contours, source->contours, (size_t)source->n_contours * sizeof(int));
+	ft->n_points = source->n_points;
+	ft->n_contours = source->n_contours;
+	ft->flags = source->flags;
+	return ft;
+}
+
+static void sw_ft_polygon_destroy(SW_FT_Polygon * ft)
+{
+	if(ft)
+	{
+		free(ft->points);
+		free(ft->contours);
+		free(ft);
+	}
+}
+
+static SW_FT_Polygon * sw_ft_polygon_convert(SW_FT_Polygon * polygon, struct cg_path_t * path, struct cg_matrix_t * m)
+{
+	enum cg_path_element_t * elements = path->elements.data;
+	for(int i = 0; i < path->elements.size; i++)
+	{
+		if(elements[i] == CG_PATH_ELEMENT_CURVE_TO)
+			return NULL;
+	}
+	polygon = sw_ft_polygon_reset(polygon, path->points.size, path->contours + 1);
+	struct cg_point_t * points = path->points.data;
+	struct cg_point_t p;
+	int start = 0;
+	for(int i = 0; i < path->elements.size; i++)
+	{
+		switch(elements[i])
+		{
+		case CG_PATH_ELEMENT_MOVE_TO:
+			if(polygon->n_points > start)
+				polygon->contours[polygon->n_contours++] = polygon->n_points - 1;
+			start = polygon->n_points;
+			cg_matrix_map_point(m, &points[0], &p);
+			polygon->points[polygon->n_points].x = p.x;
+			polygon->points[polygon->n_points].y = p.y;
+			polygon->n_points++;
+			points += 1;
+			break;
+		case CG_PATH_ELEMENT_LINE_TO:
+			cg_matrix_map_point(m, &points[0], &p);
+			polygon->points[polygon->n_points].x = p.x;
+			polygon->points[polygon->n_points].y = p.y;
+			polygon->n_points++;
+			points += 1;
+			break;
+		case CG_PATH_ELEMENT_CLOSE:
+			if(polygon->n_points > start)
+				polygon->points[polygon->n_points++] = polygon->points[start];
+			points += 1;
+			break;
+		default:
+			break;
+		}
+	}
+	if(polygon->n_points > start)
+		polygon->contours[polygon->n_contours++] = polygon->n_points - 1;
+	return polygon;
+}
+
+struct cg_scratch_t {
+	SW_FT_Outline * outline;
+	SW_FT_Polygon * polygon;
+	SW_FT_Outline * stroke;
+	SW_FT_Stroker stroker;
+	struct cg_path_t * flat;
+	struct cg_path_t * dash;
+	struct cg_rle_t * rle;
+	struct {
+		uint64_t * data;
+		int size;
+		int capacity;
+	} cells;
+	struct {
+		int * data;
+		int size;
+		int capacity;
+	} buckets;
+};
+
+static struct cg_rle_t * cg_rle_create(void);
+static void cg_rle_destroy(struct cg_rle_t * rle);
+
+static struct cg_scratch_t * cg_scratch_create(void)
+{
+	struct cg_scratch_t * scratch = malloc(sizeof(struct cg_scratch_t));
+	scratch->outline = sw_ft_outline_create(0, 0);
+	scratch->polygon = sw_ft_polygon_create(0, 0);
+	scratch->stroke = sw_ft_outline_create(0, 0);
+	SW_FT_Stroker_New(&scratch->stroker);
+	scratch->flat = cg_path_create();
+	scratch->dash = cg_path_create();
+	scratch->rle = cg_rle_create();
+	cg_array_init(scratch->cells);
+	cg_array_init(scratch->buckets);
+	return scratch;
+}
+
+static void cg_scratch_destroy(struct cg_scratch_t * scratch)
+{
+	if(scratch)
+	{
+		sw_ft_outline_destroy(scratch->outline);
+		sw_ft_polygon_destroy(scratch->polygon);
+		sw_ft_outline_destroy(scratch->stroke);
+		SW_FT_Stroker_Done(scratch->stroker);
+		cg_path_destroy(scratch->flat);
+		cg_path_destroy(scratch->dash);
+		cg_rle_destroy(scratch->rle);
+		free(scratch->cells.data);
+		free(scratch->buckets.data);
+		free(scratch);
+	}
+}
+
+static void sw_ft_outline_dash_move_to(struct cg_dasher_t * dasher, struct cg_point_t * p)
+{
+	struct cg_point_t q;
+	cg_matrix_map_point(dasher->m, p, &q);
+	sw_ft_outline_ensure(dasher->user, 1, 1);
+	sw_ft_outline_move_to(dasher->user, q.x, q.y);
+}
+
+static void sw_ft_outline_dash_line_to(struct cg_dasher_t * dasher, struct cg_point_t * p)
+{
+	struct cg_point_t q;
+	cg_matrix_map_point(dasher->m, p, &q);
+	sw_ft_outline_ensure(dasher->user, 1, 0);
+	sw_ft_outline_line_to(dasher->user, q.x, q.y);
+}
+
+static void sw_ft_outline_dash_curve_to(struct cg_dasher_t * dasher, struct cg_point_t * p)
+{
+	struct cg_point_t q[3];
+	cg_matrix_map_point(dasher->m, &p[1], &q[0]);
+	cg_matrix_map_point(dasher->m, &p[2], &q[1]);
+	cg_matrix_map_point(dasher->m, &p[3], &q[2]);
+	sw_ft_outline_ensure(dasher->user, 3, 0);
+	sw_ft_outline_curve_to(dasher->user, q[0].x, q[0].y, q[1].x, q[1].y, q[2].x, q[2].y);
+}
+
+static SW_FT_Outline * sw_ft_outline_convert_dash(struct cg_scratch_t * scratch, struct cg_path_t * path, struct cg_matrix_t * m, struct cg_dash_t * dash, double tolerance)
 {
-	struct cg_path_t * dashed = cg_dash_path(dash, path);
-	SW_FT_Outline * outline = sw_ft_outline_convert(dashed, m);
-	cg_path_destroy(dashed);
+	struct cg_dasher_t dasher;
+	SW_FT_Outline * outline = sw_ft_outline_reset(scratch->outline, path->points.size, path->contours);
+	cg_dasher_init(&dasher, dash, m, tolerance);
+	dasher.move_to = sw_ft_outline_dash_move_to;
+	dasher.line_to = sw_ft_outline_dash_line_to;
+	dasher.curve_to = sw_ft_outline_dash_curve_to;
+	dasher.user = outline;
+	cg_dasher_path(&dasher, path);
+	sw_ft_outline_end(outline);
 	return outline;
 }
 
@@ -876,6 +1299,7 @@ static void bbox_callback(int x, int y, int w, int h, void * user)
 static struct cg_rle_t * cg_rle_create(void)
 {
 	struct cg_rle_t * rle = malloc(sizeof(struct cg_rle_t));
+	rle->ref = 1;
 	cg_array_init(rle->spans);
 	rle->x = 0;
 	rle->y = 0;
@@ -884,22 +1308,126 @@ static struct cg_rle_t * cg_rle_create(void)
 	return rle;
 }
 
+static struct cg_rle_t * cg_rle_reference(struct cg_rle_t * rle)
+{
+	if(rle)
+	{
+		++rle->ref;
+		return rle;
+	}
+	return NULL;
+}
+
 static void cg_rle_destroy(struct cg_rle_t * rle)
 {
 	if(rle)
 	{
-		free(rle->spans.data);
-		free(rle);
+		if(--rle->ref == 0)
+		{
+			free(rle->spans.data);
+			free(rle);
+		}
+	}
+}
+
+static inline double cg_stroke_scale(struct cg_matrix_t * m)
+{
+	struct cg_point_t p1 = { 0, 0 };
+	struct cg_point_t p2 = { M_SQRT2, M_SQRT2 };
+
+	cg_matrix_map_point(m, &p1, &p1);
+	cg_matrix_map_point(m, &p2, &p2);
+
+	double dx = p2.x - p1.x;
+	double dy = p2.y - p1.y;
+	return sqrt(dx * dx + dy * dy) / 2.0;
+}
+
+static SW_FT_Stroker sw_ft_stroker_parse(struct cg_scratch_t * scratch, struct cg_path_t * path, struct cg_matrix_t * m, struct cg_stroke_data_t * stroke, double tolerance, SW_FT_UInt * points, SW_FT_UInt * contours)
+{
+	SW_FT_Stroker_LineCap ftCap;
+	SW_FT_Stroker_LineJoin ftJoin;
+	SW_FT_Fixed ftWidth;
+	SW_FT_Fixed ftMiterLimit;
+
+	double scale = cg_stroke_scale(m);
+	double radius = stroke->width / 2.0;
+
+	ftWidth = (SW_FT_Fixed)(radius * scale * (1 << 6));
+	ftMiterLimit = (SW_FT_Fixed)(stroke->miterlimit * (1 << 16));
+
+	switch(stroke->cap)
+	{
+	case CG_LINE_CAP_ROUND:
+		ftCap = SW_FT_STROKER_LINECAP_ROUND;
+		break;
+	case CG_LINE_CAP_SQUARE:
+		ftCap = SW_FT_STROKER_LINECAP_SQUARE;
+		break;
+	default:
+		ftCap = SW_FT_STROKER_LINECAP_BUTT;
+		break;
+	}
+	switch(stroke->join)
+	{
+	case CG_LINE_JOIN_ROUND:
+		ftJoin = SW_FT_STROKER_LINEJOIN_ROUND;
+		break;
+	case CG_LINE_JOIN_BEVEL:
+		ftJoin = SW_FT_STROKER_LINEJOIN_BEVEL;
+		break;
+	default:
+		ftJoin = SW_FT_STROKER_LINEJOIN_MITER_FIXED;
+		break;
 	}
+	SW_FT_Outline * outline = stroke->dash ? sw_ft_outline_convert_dash(scratch, path, m, stroke->dash, tolerance) : sw_ft_outline_convert(scratch->outline, path, m);
+	SW_FT_Stroker stroker = scratch->stroker;
+	SW_FT_Stroker_Set(stroker, ftWidth, ftCap, ftJoin, ftMiterLimit);
+	SW_FT_Stroker_ParseOutline(stroker, outline);
+
+	SW_FT_Stroker_GetCounts(stroker, points, contours);
+	return stroker;
+}
+
+static SW_FT_Outline * sw_ft_outline_convert_stroke(struct cg_scratch_t * scratch, struct cg_path_t * path, struct cg_matrix_t * m, struct cg_stroke_data_t * stroke, double tolerance)
+{
+	SW_FT_UInt points;
+	SW_FT_UInt contours;
+	SW_FT_Stroker stroker = sw_ft_stroker_parse(scratch, path, m, stroke, tolerance, &points, &contours);
+
+	SW_FT_Outline * strokeOutline = sw_ft_outline_reset(scratch->stroke, (int)points, (int)contours);
+	SW_FT_Stroker_Export(stroker, strokeOutline);
+	SW_FT_Stroker_Rewind(stroker);
+
+	strokeOutline->flags = SW_FT_OUTLINE_NONE;
+	return strokeOutline;
+}
+
+static SW_FT_Outline * sw_ft_outline_generate(struct cg_scratch_t * scratch, struct cg_path_t * path, struct cg_matrix_t * m, struct cg_stroke_data_t * stroke, enum cg_fill_rule_t winding, double tolerance)
+{
+	if(stroke)
+		return sw_ft_outline_convert_stroke(scratch, path, m, stroke, tolerance);
+	SW_FT_Outline * outline = sw_ft_outline_convert(scratch->outline, path, m);
+	outline->flags = (winding == CG_FILL_RULE_EVEN_ODD) ? SW_FT_OUTLINE_EVEN_ODD_FILL : SW_FT_OUTLINE_NONE;
+	return outline;
+}
+
+static SW_FT_Polygon * sw_ft_polygon_generate(struct cg_scratch_t * scratch, struct cg_path_t * path, struct cg_matrix_t * m, enum cg_fill_rule_t winding)
+{
+	SW_FT_Polygon * polygon = sw_ft_polygon_convert(scratch->polygon, path, m);
+	if(polygon)
+		polygon->flags = (winding == CG_FILL_RULE_EVEN_ODD) ? SW_FT_OUTLINE_EVEN_ODD_FILL : SW_FT_OUTLINE_NONE;
+	return polygon;
 }
 
-static void cg_rle_rasterize(struct cg_rle_t * rle, struct cg_path_t * path, struct cg_matrix_t * m, struct cg_rect_t * clip, struct cg_stroke_data_t * stroke, enum cg_fill_rule_t winding)
+static void cg_rle_rasterize_source(struct cg_rle_t * rle, SW_FT_Raster raster, const void * source, int flags, struct cg_rect_t * clip)
 {
 	SW_FT_Raster_Params params;
-	params.flags = SW_FT_RASTER_FLAG_DIRECT | SW_FT_RASTER_FLAG_AA;
+	params.flags = SW_FT_RASTER_FLAG_DIRECT | flags;
 	params.gray_spans = generation_callback;
 	params.bbox_cb = bbox_callback;
 	params.user = rle;
+	params.source = source;
 
 	if(clip)
 	{
@@ -909,92 +1437,455 @@ static void cg_rle_rasterize(struct cg_rle_t * rle, struct cg_path_t * path, str
 		params.clip_box.xMax = (SW_FT_Pos)(clip->x + clip->w);
 		params.clip_box.yMax = (SW_FT_Pos)(clip->y + clip->h);
 	}
-	if(stroke)
-	{
-		SW_FT_Stroker_LineCap ftCap;
-		SW_FT_Stroker_LineJoin ftJoin;
-		SW_FT_Fixed ftWidth;
-		SW_FT_Fixed ftMiterLimit;
-
-		struct cg_point_t p1 = { 0, 0 };
-		struct cg_point_t p2 = { M_SQRT2, M_SQRT2 };
-
-		cg_matrix_map_point(m, &p1, &p1);
-		cg_matrix_map_point(m, &p2, &p2);
-
-		double dx = p2.x - p1.x;
-		double dy = p2.y - p1.y;
+	sw_ft_grays_raster.raster_render(raster, &params);
+}
 
-		double scale = sqrt(dx * dx + dy * dy) / 2.0;
-		double radius = stroke->width / 2.0;
+static inline int cg_raster_flags(struct cg_ctx_t * ctx)
+{
+	int flags = (ctx->state->antialias == CG_ANTIALIAS_NONE) ? 0 : SW_FT_RASTER_FLAG_AA;
+	if(ctx->rasterizer == CG_RASTERIZER_ACCUMULATE)
+		flags |= SW_FT_RASTER_FLAG_ACCUMULATE;
+	return flags;
+}
 
-		ftWidth = (SW_FT_Fixed)(radius * scale * (1 << 6));
-		ftMiterLimit = (SW_FT_Fixed)(stroke->miterlimit * (1 << 16));
+static inline int cg_rle_coverage(long area)
+{
+	int coverage = (int)(area >> 9);
+	if(coverage < 0)
+		coverage = -coverage;
+	return (coverage >= 256) ? 255 : coverage;
+}
 
-		switch(stroke->cap)
+static inline void cg_rle_add_span(struct cg_rle_t * rle, int start, int x, int y, int len, int coverage)
+{
+	if(coverage && (len > 0))
+	{
+		struct cg_span_t * span;
+		if(rle->spans.size > start)
 		{
-		case CG_LINE_CAP_ROUND:
-			ftCap = SW_FT_STROKER_LINECAP_ROUND;
-			break;
-		case CG_LINE_CAP_SQUARE:
-			ftCap = SW_FT_STROKER_LINECAP_SQUARE;
-			break;
-		default:
-			ftCap = SW_FT_STROKER_LINECAP_BUTT;
-			break;
+			span = rle->spans.data + rle->spans.size - 1;
+			if((span->y == y) && (span->x + span->len == x) && (span->coverage == coverage))
+			{
+				span->len += len;
+				return;
+			}
 		}
-		switch(stroke->join)
+		cg_array_ensure(rle->spans, 1);
+		span = rle->spans.data + rle->spans.size;
+		span->x = x;
+		span->y = y;
+		span->len = len;
+		span->coverage = coverage;
+		rle->spans.size += 1;
+	}
+}
+
+static void cg_rle_bounds(struct cg_rle_t * rle, int start);
+
+static void cg_rle_rectangle(struct cg_rle_t * rle, SW_FT_Pos x1, SW_FT_Pos y1, SW_FT_Pos x2, SW_FT_Pos y2, int dir, struct cg_rect_t * clip)
+{
+	int start = rle->spans.size;
+	int cx1 = (int)clip->x;
+	int cy1 = (int)clip->y;
+	int cx2 = (int)(clip->x + clip->w);
+	int cy2 = (int)(clip->y + clip->h);
+	x1 <<= 2;
+	y1 <<= 2;
+	x2 <<= 2;
+	y2 <<= 2;
+	int ex1 = (int)(x1 >> 8);
+	int ex2 = (int)(x2 >> 8);
+	long fx1 = x1 & 255;
+	long fx2 = x2 & 255;
+	int ey1 = CG_MAX((int)(y1 >> 8), cy1);
+	int ey2 = CG_MIN((int)((y2 - 1) >> 8) + 1, cy2);
+	int l = CG_MAX(ex1 + 1, cx1);
+	int r = CG_MIN(ex2, cx2);
+	if((x1 < x2) && (y1 < y2))
+	{
+		for(int y = ey1; y < ey2; y++)
 		{
-		case CG_LINE_JOIN_ROUND:
-			ftJoin = SW_FT_STROKER_LINEJOIN_ROUND;
-			break;
-		case CG_LINE_JOIN_BEVEL:
-			ftJoin = SW_FT_STROKER_LINEJOIN_BEVEL;
-			break;
-		default:
-			ftJoin = SW_FT_STROKER_LINEJOIN_MITER_FIXED;
-			break;
+			long h = dir * (CG_MIN(y2, (SW_FT_Pos)(y + 1) << 8) - CG_MAX(y1, (SW_FT_Pos)y << 8));
+			if(ex1 == ex2)
+			{
+				if((ex1 >= cx1) && (ex1 < cx2))
+					cg_rle_add_span(rle, start, ex1, y, 1, cg_rle_coverage(h * (fx2 - fx1) * 2));
+			}
+			else
+			{
+				if((ex1 >= cx1) && (ex1 < cx2))
+					cg_rle_add_span(rle, start, ex1, y, 1, cg_rle_coverage(h * (512 - fx1 * 2)));
+				cg_rle_add_span(rle, start, l, y, r - l, cg_rle_coverage(h * 512));
+				if((ex2 >= cx1) && (ex2 < cx2))
+					cg_rle_add_span(rle, start, ex2, y, 1, cg_rle_coverage(h * fx2 * 2));
+			}
+		}
+	}
+	cg_rle_bounds(rle, start);
+}
+
+static void cg_rle_bounds(struct cg_rle_t * rle, int start)
+{
+	if(rle->spans.size == start)
+	{
+		rle->x = 0;
+		rle->y = 0;
+		rle->w = 0;
+		rle->h = 0;
+		return;
+	}
+	struct cg_span_t * spans = rle->spans.data + start;
+	int n = rle->spans.size - start;
+	int bx1 = INT_MAX;
+	int bx2 = INT_MIN;
+	for(int i = 0; i < n; i++)
+	{
+		if(spans[i].x < bx1)
+			bx1 = spans[i].x;
+		if(spans[i].x + spans[i].len > bx2)
+			bx2 = spans[i].x + spans[i].len;
+	}
+	rle->x = bx1;
+	rle->y = spans[0].y;
+	rle->w = bx2 - bx1;
+	rle->h = spans[n - 1].y - spans[0].y + 1;
+}
+
+static int cg_path_is_rectangle(struct cg_path_t * path, struct cg_matrix_t * m, SW_FT_BBox * box, int * dir)
+{
+	enum cg_path_element_t * elements = path->elements.data;
+	int n = path->elements.size;
+	if((n > 0) && (elements[n - 1] == CG_PATH_ELEMENT_CLOSE))
+		n--;
+	if((n == 5) && (elements[4] == CG_PATH_ELEMENT_LINE_TO))
+		n--;
+	if((n != 4) || (elements[0] != CG_PATH_ELEMENT_MOVE_TO) || (elements[1] != CG_PATH_ELEMENT_LINE_TO) || (elements[2] != CG_PATH_ELEMENT_LINE_TO) || (elements[3] != CG_PATH_ELEMENT_LINE_TO))
+		return 0;
+	SW_FT_Vector p[5];
+	struct cg_point_t pt;
+	for(int i = 0; i < n + 1 && i < path->points.size; i++)
+	{
+		cg_matrix_map_point(m, &path->points.data[i], &pt);
+		p[i].x = FT_COORD(pt.x);
+		p[i].y = FT_COORD(pt.y);
+	}
+	if((path->elements.size > 4) && (elements[4] == CG_PATH_ELEMENT_LINE_TO) && ((p[4].x != p[0].x) || (p[4].y != p[0].y)))
+		return 0;
+	SW_FT_Vector * a;
+	SW_FT_Vector * b;
+	if((p[0].x == p[1].x) && (p[1].y == p[2].y) && (p[2].x == p[3].x) && (p[3].y == p[0].y))
+	{
+		a = &p[0];
+		b = &p[2];
+	}
+	else if((p[0].y == p[1].y) && (p[1].x == p[2].x) && (p[2].y == p[3].y) && (p[3].x == p[0].x))
+	{
+		a = &p[1];
+		b = &p[3];
+		p[4] = p[0];
+	}
+	else
+		return 0;
+	SW_FT_Vector * left = (a->x < b->x) ? a : b;
+	box->xMin = CG_MIN(a->x, b->x);
+	box->yMin = CG_MIN(a[0].y, a[1].y);
+	box->xMax = CG_MAX(a->x, b->x);
+	box->yMax = CG_MAX(a[0].y, a[1].y);
+	*dir = (left[1].y > left[0].y) ? 1 : -1;
+	return 1;
+}
+
+static int cg_rle_rasterize_rectangle(struct cg_rle_t * rle, struct cg_path_t * path, struct cg_matrix_t * m, struct cg_rect_t * clip, int flags)
+{
+	SW_FT_BBox box;
+	int dir;
+	if(!cg_path_is_rectangle(path, m, &box, &dir))
+		return 0;
+	if(!(flags & SW_FT_RASTER_FLAG_AA))
+	{
+		box.xMin = (box.xMin + 31) & -64;
+		box.yMin = (box.yMin + 31) & -64;
+		box.xMax = (box.xMax + 31) & -64;
+		box.yMax = (box.yMax + 31) & -64;
+	}
+	cg_rle_rectangle(rle, box.xMin, box.yMin, box.xMax, box.yMax, dir, clip);
+	return 1;
+}
+
+struct cg_hairline_t {
+	struct cg_scratch_t * scratch;
+	int * area;
+	int x1, y1;
+	int x2, y2;
+	double width;
+};
+
+static void cg_hairline_segment(struct cg_hairline_t * h, double x0, double y0, double x1, double y1, double e0, double e1)
+{
+	double dx = x1 - x0;
+	double dy = y1 - y0;
+	double len = sqrt(dx * dx + dy * dy);
+	if(!(len > 0))
+		return;
+	x0 -= dx * e0 / len;
+	y0 -= dy * e0 / len;
+	x1 += dx * e1 / len;
+	y1 += dy * e1 / len;
+	int steep = fabs(dy) > fabs(dx);
+	double t;
+	if(steep)
+	{
+		t = x0; x0 = y0; y0 = t;
+		t = x1; x1 = y1; y1 = t;
+	}
+	if(x0 > x1)
+	{
+		t = x0; x0 = x1; x1 = t;
+		t = y0; y0 = y1; y1 = t;
+	}
+	double slope = (y1 - y0) / (x1 - x0);
+	double half = h->width * len / fabs(steep ? dy : dx) * 0.5;
+	double uclip1 = steep ? h->y1 : h->x1;
+	double uclip2 = steep ? h->y2 : h->x2;
+	int umin = (int)CG_CLAMP(floor(x0), uclip1, uclip2);
+	int umax = (int)CG_CLAMP(ceil(x1), uclip1, uclip2);
+	int vclip1 = (steep ? h->x1 : h->y1) << 8;
+	int vclip2 = (steep ? h->x2 : h->y2) << 8;
+	if(h->area)
+	{
+		int stride = h->x2 - h->x1 + 2;
+		int ustep = steep ? stride : 1;
+		int vstep = steep ? 1 : stride;
+		for(int u = umin; u < umax; u++)
+		{
+			double a = CG_MAX(x0, (double)u);
+			double b = CG_MIN(x1, (double)(u + 1));
+			double v = (y0 + ((a + b) * 0.5 - x0) * slope) * 256.0;
+			int t = (int)CG_CLAMP(v - half * 256.0, (double)vclip1, (double)vclip2);
+			int e = (int)CG_CLAMP(v + half * 256.0, (double)vclip1, (double)vclip2);
+			if(t >= e)
+				continue;
+			int fu = (int)((b - a) * 256.0 + 0.5) * 255;
+			int r = t & ~255;
+			int * p = h->area + (u - (int)uclip1) * ustep + ((r - vclip1) >> 8) * vstep;
+			p[0] += ((CG_MIN(e, r + 256) - t) * fu + 32768) >> 16;
+			p[vstep] += (CG_MAX(CG_MIN(e, r + 512) - (r + 256), 0) * fu + 32768) >> 16;
+			p[vstep * 2] += (CG_MAX(e - (r + 512), 0) * fu + 32768) >> 16;
+		}
+		return;
+	}
+	struct cg_scratch_t * scratch = h->scratch;
+	for(int u = umin; u < umax; u++)
+	{
+		double a = CG_MAX(x0, (double)u);
+		double b = CG_MIN(x1, (double)(u + 1));
+		double v = (y0 + ((a + b) * 0.5 - x0) * slope) * 256.0;
+		int t = (int)CG_CLAMP(v - half * 256.0, (double)vclip1, (double)vclip2);
+		int e = (int)CG_CLAMP(v + half * 256.0, (double)vclip1, (double)vclip2);
+		int fu = (int)((b - a) * 256.0 + 0.5) * 255;
+		for(int w = t >> 8; (w << 8) < e; w++)
+		{
+			int coverage = ((CG_MIN(e, (w + 1) << 8) - CG_MAX(t, w << 8)) * fu + 32768) >> 16;
+			if(coverage > 0)
+			{
+				uint64_t x = (uint64_t)(steep ? w : u);
+				uint64_t y = (uint64_t)(steep ? u : w);
+				cg_array_ensure(scratch->cells, 1);
+				scratch->cells.data[scratch->cells.size++] = (y << 40) | (x << 16) | (uint64_t)coverage;
+			}
 		}
-		SW_FT_Outline * outline = stroke->dash ? sw_ft_outline_convert_dash(path, m, stroke->dash) : sw_ft_outline_convert(path, m);
-		SW_FT_Stroker stroker;
-		SW_FT_Stroker_New(&stroker);
-		SW_FT_Stroker_Set(stroker, ftWidth, ftCap, ftJoin, ftMiterLimit);
-		SW_FT_Stroker_ParseOutline(stroker, outline);
+	}
+}
+
+static void cg_hairline_radix(uint64_t * dst, uint64_t * src, int count, int * buckets, int shift, int base, int n)
+{
+	memset(buckets, 0, (size_t)(n + 1) * sizeof(int));
+	for(int i = 0; i < count; i++)
+		buckets[(int)((src[i] >> shift) & 0xffffff) - base + 1]++;
+	for(int i = 1; i <= n; i++)
+		buckets[i] += buckets[i - 1];
+	for(int i = 0; i < count; i++)
+		dst[buckets[(int)((src[i] >> shift) & 0xffffff) - base]++] = src[i];
+}
 
-		SW_FT_UInt points;
-		SW_FT_UInt contours;
-		SW_FT_Stroker_GetCounts(stroker, &points, &contours);
+static void cg_hairline_sort(struct cg_hairline_t * h)
+{
+	struct cg_scratch_t * scratch = h->scratch;
+	int count = scratch->cells.size;
+	if(count == 0)
+		return;
+	cg_array_ensure(scratch->cells, count);
+	uint64_t * cells = scratch->cells.data;
+	int w = h->x2 - h->x1;
+	int n = h->y2 - h->y1;
+	scratch->buckets.size = 0;
+	cg_array_ensure(scratch->buckets, CG_MAX(w, n) + 1);
+	cg_hairline_radix(cells + count, cells, count, scratch->buckets.data, 16, h->x1, w);
+	cg_hairline_radix(cells, cells + count, count, scratch->buckets.data, 40, h->y1, n);
+}
 
-		SW_FT_Outline * strokeOutline = sw_ft_outline_create((int)points, (int)contours);
-		SW_FT_Stroker_Export(stroker, strokeOutline);
-		SW_FT_Stroker_Done(stroker);
+static inline int cg_stroke_is_hairline(struct cg_stroke_data_t * stroke, struct cg_matrix_t * m)
+{
+	double width = stroke->width * cg_stroke_scale(m);
+	return (width > 0) && (width <= 1.0) && (stroke->cap != CG_LINE_CAP_ROUND);
+}
 
-		strokeOutline->flags = SW_FT_OUTLINE_NONE;
-		params.source = strokeOutline;
-		sw_ft_grays_raster.raster_render(NULL, &params);
-		sw_ft_outline_destroy(outline);
-		sw_ft_outline_destroy(strokeOutline);
+static int cg_rle_rasterize_hairline(struct cg_rle_t * rle, struct cg_scratch_t * scratch, struct cg_path_t * path, struct cg_matrix_t * m, struct cg_rect_t * clip, struct cg_stroke_data_t * stroke, double tolerance)
+{
+	if(!cg_stroke_is_hairline(stroke, m))
+		return 0;
+	double width = stroke->width * cg_stroke_scale(m);
+	struct cg_path_t * flat = stroke->dash ? cg_dash_path(scratch->dash, stroke->dash, path, m, tolerance) : cg_path_clone_flat(scratch->flat, path, m, tolerance);
+	enum cg_path_element_t * elements = flat->elements.data;
+	struct cg_point_t * points = flat->points.data;
+	int n = flat->elements.size;
+	int start = rle->spans.size;
+	if(n == 0)
+	{
+		cg_rle_bounds(rle, start);
+		return 1;
+	}
+	double xmin = INFINITY, ymin = INFINITY;
+	double xmax = -INFINITY, ymax = -INFINITY;
+	double estimate = 0;
+	for(int i = 0; i < n; i++)
+	{
+		cg_matrix_map_point(m, &points[i], &points[i]);
+		xmin = fmin(xmin, points[i].x);
+		ymin = fmin(ymin, points[i].y);
+		xmax = fmax(xmax, points[i].x);
+		ymax = fmax(ymax, points[i].y);
+		if((i > 0) && (elements[i] != CG_PATH_ELEMENT_MOVE_TO))
+			estimate += fmax(fabs(points[i].x - points[i - 1].x), fabs(points[i].y - points[i - 1].y)) * 2.0 + 2.0;
+	}
+	struct cg_hairline_t h;
+	h.scratch = scratch;
+	h.area = NULL;
+	h.x1 = (int)CG_CLAMP(floor(xmin) - 2.0, clip->x, clip->x + clip->w);
+	h.y1 = (int)CG_CLAMP(floor(ymin) - 2.0, clip->y, clip->y + clip->h);
+	h.x2 = (int)CG_CLAMP(ceil(xmax) + 2.0, clip->x, clip->x + clip->w);
+	h.y2 = (int)CG_CLAMP(ceil(ymax) + 2.0, clip->y, clip->y + clip->h);
+	h.width = width;
+	if((h.x1 >= h.x2) || (h.y1 >= h.y2))
+	{
+		cg_rle_bounds(rle, start);
+		return 1;
+	}
+	int stride = h.x2 - h.x1 + 2;
+	size_t size = (size_t)stride * (size_t)(h.y2 - h.y1 + 2);
+	if((size <= estimate * 2.0) && (size <= (size_t)(INT_MAX >> 2)))
+	{
+		scratch->buckets.size = 0;
+		cg_array_ensure(scratch->buckets, (int)size);
+		h.area = scratch->buckets.data;
+		memset(h.area, 0, size * sizeof(int));
+	}
+	double cap = (stroke->cap == CG_LINE_CAP_BUTT) ? 0 : width * 0.5;
+	int first = 1;
+	int closed = 0;
+	scratch->cells.size = 0;
+	for(int i = 0; i < n; i++)
+	{
+		if((i > 0) && (elements[i] != CG_PATH_ELEMENT_MOVE_TO))
+		{
+			if(first)
+			{
+				int j = i;
+				while((j + 1 < n) && (elements[j + 1] != CG_PATH_ELEMENT_MOVE_TO))
+					j++;
+				closed = (elements[j] == CG_PATH_ELEMENT_CLOSE);
+			}
+			int last = (i + 1 == n) || (elements[i + 1] == CG_PATH_ELEMENT_MOVE_TO);
+			cg_hairline_segment(&h, points[i - 1].x, points[i - 1].y, points[i].x, points[i].y, (first && !closed) ? cap : 0, (last && !closed) ? cap : 0);
+			first = 0;
+		}
+		else
+		{
+			first = 1;
+		}
+	}
+	if(h.area)
+	{
+		for(int y = h.y1; y < h.y2; y++)
+		{
+			int * row = h.area + (y - h.y1) * stride;
+			for(int x = 0; x < stride - 2; x++)
+			{
+				if(row[x])
+					cg_rle_add_span(rle, start, h.x1 + x, y, 1, CG_MIN(row[x], 255));
+			}
+		}
 	}
 	else
 	{
-		SW_FT_Outline * outline = sw_ft_outline_convert(path, m);
-		outline->flags = (winding == CG_FILL_RULE_EVEN_ODD) ? SW_FT_OUTLINE_EVEN_ODD_FILL : SW_FT_OUTLINE_NONE;
-		params.source = outline;
-		sw_ft_grays_raster.raster_render(NULL, &params);
-		sw_ft_outline_destroy(outline);
+		cg_hairline_sort(&h);
+		uint64_t * cells = scratch->cells.data;
+		int count = scratch->cells.size;
+		int i = 0;
+		while(i < count)
+		{
+			uint64_t key = cells[i] >> 16;
+			int coverage = 0;
+			for(; (i < count) && ((cells[i] >> 16) == key); i++)
+				coverage += (int)(cells[i] & 0xffff);
+			cg_rle_add_span(rle, start, (int)(key & 0xffffff), (int)(key >> 24), 1, CG_MIN(coverage, 255));
+		}
+	}
+	cg_rle_bounds(rle, start);
+	return 1;
+}
+
+static void cg_rle_rasterize(struct cg_rle_t * rle, SW_FT_Raster raster, int flags, struct cg_scratch_t * scratch, struct cg_path_t * path, struct cg_matrix_t * m, struct cg_rect_t * clip, struct cg_stroke_data_t * stroke, enum cg_fill_rule_t winding, double tolerance)
+{
+	if(!stroke)
+	{
+		if(cg_rle_rasterize_rectangle(rle, path, m, clip, flags))
+			return;
+		SW_FT_Polygon * polygon = sw_ft_polygon_generate(scratch, path, m, winding);
+		if(polygon)
+		{
+			cg_rle_rasterize_source(rle, raster, polygon, flags | SW_FT_RASTER_FLAG_POLYGON, clip);
+			return;
+		}
+	}
+	SW_FT_Outline * outline = sw_ft_outline_generate(scratch, path, m, stroke, winding, tolerance);
+	cg_rle_rasterize_source(rle, raster, outline, flags, clip);
+}
+
+static inline int cg_rle_lower_bound(struct cg_rle_t * rle, int y)
+{
+	int l = 0, r = rle->spans.size;
+	while(l < r)
+	{
+		int m = (l + r) >> 1;
+		if(rle->spans.data[m].y < y)
+			l = m + 1;
+		else
+			r = m;
 	}
+	return l;
 }
 
-static struct cg_rle_t * cg_rle_intersection(struct cg_rle_t * a, struct cg_rle_t * b)
+static struct cg_rle_t * cg_rle_intersection(struct cg_rle_t * result, struct cg_rle_t * a, struct cg_rle_t * b)
 {
-	struct cg_rle_t * result = malloc(sizeof(struct cg_rle_t));
-	cg_array_init(result->spans);
-	cg_array_ensure(result->spans, CG_MAX(a->spans.size, b->spans.size));
+	result->spans.size = 0;
+	result->x = 0;
+	result->y = 0;
+	result->w = 0;
+	result->h = 0;
+	int y1 = CG_MAX(a->y, b->y);
+	int y2 = CG_MIN(a->y + a->h, b->y + b->h);
+	if((a->spans.size == 0) || (b->spans.size == 0) || (y1 >= y2) || (a->x >= b->x + b->w) || (b->x >= a->x + a->w))
+		return result;
+	cg_array_ensure(result->spans, a->spans.size + b->spans.size);
 
-	struct cg_span_t * a_spans = a->spans.data;
-	struct cg_span_t * a_end = a_spans + a->spans.size;
-	struct cg_span_t * b_spans = b->spans.data;
-	struct cg_span_t * b_end = b_spans + b->spans.size;
+	struct cg_span_t * a_spans = a->spans.data + cg_rle_lower_bound(a, y1);
+	struct cg_span_t * a_end = a->spans.data + cg_rle_lower_bound(a, y2);
+	struct cg_span_t * b_spans = b->spans.data + cg_rle_lower_bound(b, y1);
+	struct cg_span_t * b_end = b->spans.data + cg_rle_lower_bound(b, y2);
+	struct cg_span_t * span = result->spans.data;
+	int x1 = INT_MAX;
+	int x2 = INT_MIN;
 	while((a_spans < a_end) && (b_spans < b_end))
 	{
 		if(b_spans->y > a_spans->y)
@@ -1025,12 +1916,15 @@ static struct cg_rle_t * cg_rle_intersection(struct cg_rle_t * a, struct cg_rle_
 		int len = CG_MIN(ax2, bx2) - x;
 		if(len)
 		{
-			struct cg_span_t * span = result->spans.data + result->spans.size;
 			span->x = x;
 			span->len = len;
 			span->y = a_spans->y;
 			span->coverage = CG_DIV255(a_spans->coverage * b_spans->coverage);
-			result->spans.size += 1;
+			if(x < x1)
+				x1 = x;
+			if(x + len > x2)
+				x2 = x + len;
+			span++;
 		}
 		if(ax2 < bx2)
 		{
@@ -1041,48 +1935,66 @@ static struct cg_rle_t * cg_rle_intersection(struct cg_rle_t * a, struct cg_rle_
 			++b_spans;
 		}
 	}
-	if(result->spans.size == 0)
+	result->spans.size = span - result->spans.data;
+	if(result->spans.size > 0)
 	{
-		result->x = 0;
-		result->y = 0;
-		result->w = 0;
-		result->h = 0;
-		return result;
+		result->x = x1;
+		result->y = result->spans.data[0].y;
+		result->w = x2 - x1;
+		result->h = span[-1].y - result->y + 1;
 	}
-	struct cg_span_t * spans = result->spans.data;
-	int x1 = INT_MAX;
-	int y1 = spans[0].y;
-	int x2 = 0;
-	int y2 = spans[result->spans.size - 1].y;
-	for(int i = 0; i < result->spans.size; i++)
+	return result;
+}
+
+static int cg_rle_contains(struct cg_rle_t * clip, struct cg_rle_t * rle)
+{
+	if((clip->spans.size == 0) || (rle->spans.size == 0))
+		return 0;
+	if((rle->x < clip->x) || (rle->y < clip->y) || (rle->x + rle->w > clip->x + clip->w) || (rle->y + rle->h > clip->y + clip->h))
+		return 0;
+	int i = cg_rle_lower_bound(clip, rle->y);
+	if(clip->spans.size - i < rle->h)
+		return 0;
+	struct cg_span_t * spans = clip->spans.data + i;
+	int x2 = rle->x + rle->w;
+	for(int k = 0; k < rle->h; k++)
 	{
-		if(spans[i].x < x1)
-			x1 = spans[i].x;
-		if(spans[i].x + spans[i].len > x2)
-			x2 = spans[i].x + spans[i].len;
+		if((spans[k].y != rle->y + k) || (spans[k].coverage != 255) || (spans[k].x > rle->x) || (spans[k].x + spans[k].len < x2))
+			return 0;
 	}
-	result->x = x1;
-	result->y = y1;
-	result->w = x2 - x1;
-	result->h = y2 - y1 + 1;
+	return 1;
+}
 
-	return result;
+static void cg_rle_exchange(struct cg_rle_t * rle, struct cg_rle_t * tmp)
+{
+	struct cg_rle_t swap;
+	swap.spans = rle->spans;
+	rle->spans = tmp->spans;
+	rle->x = tmp->x;
+	rle->y = tmp->y;
+	rle->w = tmp->w;
+	rle->h = tmp->h;
+	tmp->spans = swap.spans;
 }
 
-static void cg_rle_intersect(struct cg_rle_t * rle, struct cg_rle_t * clip)
+static void cg_rle_intersect(struct cg_rle_t * rle, struct cg_rle_t * clip, struct cg_rle_t * tmp)
 {
-	if(rle && clip)
+	if(rle && clip && !cg_rle_contains(clip, rle))
+		cg_rle_exchange(rle, cg_rle_intersection(tmp, rle, clip));
+}
+
+static struct cg_rle_t * cg_rle_clip(struct cg_rle_t * clippath, struct cg_rle_t * rle, struct cg_rle_t * tmp)
+{
+	if(cg_rle_contains(rle, clippath))
+		return clippath;
+	if(clippath->ref > 1)
 	{
-		struct cg_rle_t * result = cg_rle_intersection(rle, clip);
-		cg_array_ensure(rle->spans, result->spans.size);
-		memcpy(rle->spans.data, result->spans.data, (size_t)result->spans.size * sizeof(struct cg_span_t));
-		rle->spans.size = result->spans.size;
-		rle->x = result->x;
-		rle->y = result->y;
-		rle->w = result->w;
-		rle->h = result->h;
-		cg_rle_destroy(result);
+		struct cg_rle_t * result = cg_rle_intersection(cg_rle_create(), clippath, rle);
+		cg_rle_destroy(clippath);
+		return result;
 	}
+	cg_rle_exchange(clippath, cg_rle_intersection(tmp, clippath, rle));
+	return clippath;
 }
 
 static struct cg_rle_t * cg_rle_clone(struct cg_rle_t * rle)
@@ -1090,6 +2002,7 @@ static struct cg_rle_t * cg_rle_clone(struct cg_rle_t * rle)
 	if(rle)
 	{
 		struct cg_rle_t * result = malloc(sizeof(struct cg_rle_t));
+		result->ref = 1;
 		cg_array_init(result->spans);
 		cg_array_ensure(result->spans, rle->spans.size);
 		memcpy(result->spans.data, rle->spans.data, (size_t)rle->spans.size * sizeof(struct cg_span_t));
@@ -1112,6 +2025,19 @@ static inline void cg_rle_clear(struct cg_rle_t * rle)
 	rle->h = 0;
 }
 
+static inline void cg_rle_slice(struct cg_rle_t * slice, struct cg_rle_t * rle, int y1, int y2)
+{
+	int i = cg_rle_lower_bound(rle, y1);
+	int j = cg_rle_lower_bound(rle, y2);
+	slice->spans.data = rle->spans.data + i;
+	slice->spans.size = j - i;
+	slice->spans.capacity = j - i;
+	slice->x = rle->x;
+	slice->y = y1;
+	slice->w = rle->w;
+	slice->h = y2 - y1;
+}
+
 struct cg_gradient_t * cg_gradient_create_linear(double x1, double y1, double x2, double y2)
 {
 	struct cg_gradient_t * gradient = malloc(sizeof(struct cg_gradient_t));
@@ -1121,6 +2047,8 @@ struct cg_gradient_t * cg_gradient_create_linear(double x1, double y1, double x2
 	gradient->spread = CG_SPREAD_METHOD_PAD;
 	gradient->opacity = 1.0;
 	cg_array_init(gradient->stops);
+	gradient->colortable = NULL;
+	gradient->colortable_opacity = -1.0;
 	cg_matrix_init_identity(&gradient->matrix);
 	gradient->values[0] = x1;
 	gradient->values[1] = y1;
@@ -1138,6 +2066,8 @@ struct cg_gradient_t * cg_gradient_create_radial(double cx, double cy, double cr
 	gradient->spread = CG_SPREAD_METHOD_PAD;
 	gradient->opacity = 1.0;
 	cg_array_init(gradient->stops);
+	gradient->colortable = NULL;
+	gradient->colortable_opacity = -1.0;
 	cg_matrix_init_identity(&gradient->matrix);
 	gradient->values[0] = cx;
 	gradient->values[1] = cy;
@@ -1155,6 +2085,7 @@ void cg_gradient_destroy(struct cg_gradient_t * gradient)
 		if(--gradient->ref == 0)
 		{
 			free(gradient->stops.data);
+			free(gradient->colortable);
 			free(gradient);
 		}
 	}
@@ -1207,6 +2138,7 @@ void cg_gradient_add_stop_rgba(struct cg_gradient_t * gradient, double offset, d
 	stop->offset = offset;
 	cg_color_init_rgba(&stop->color, r, g, b, a);
 	gradient->stops.size += 1;
+	gradient->colortable_opacity = -1.0;
 }
 
 void cg_gradient_add_stop_color(struct cg_gradient_t * gradient, double offset, struct cg_color_t * color)
@@ -1222,11 +2154,13 @@ void cg_gradient_add_stop(struct cg_gradient_t * gradient, struct cg_gradient_st
 void cg_gradient_clear_stops(struct cg_gradient_t * gradient)
 {
 	gradient->stops.size = 0;
+	gradient->colortable_opacity = -1.0;
 }
 
 void cg_gradient_set_opacity(struct cg_gradient_t * gradient, double opacity)
 {
 	gradient->opacity = CG_CLAMP(opacity, 0.0, 1.0);
+	gradient->colortable_opacity = -1.0;
 }
 
 struct cg_texture_t * cg_texture_create(struct cg_surface_t * surface)
@@ -1234,18 +2168,96 @@ struct cg_texture_t * cg_texture_create(struct cg_surface_t * surface)
 	struct cg_texture_t * texture = malloc(sizeof(struct cg_texture_t));
 	texture->ref = 1;
 	texture->type = CG_TEXTURE_TYPE_PLAIN;
+	texture->filter = CG_TEXTURE_FILTER_NEAREST;
 	texture->surface = cg_surface_reference(surface);
 	texture->opacity = 1.0;
+	texture->mipmap = 0;
+	texture->generation = 0;
+	texture->nlevel = 0;
+	texture->levels = NULL;
 	cg_matrix_init_identity(&texture->matrix);
 	return texture;
 }
 
+static void cg_texture_clear_levels(struct cg_texture_t * texture)
+{
+	for(int i = 0; i < texture->nlevel; i++)
+		cg_surface_destroy(texture->levels[i]);
+	free(texture->levels);
+	texture->nlevel = 0;
+	texture->levels = NULL;
+}
+
+static struct cg_surface_t * cg_surface_downsample(struct cg_surface_t * surface)
+{
+	int width = CG_MAX(surface->width >> 1, 1);
+	int height = CG_MAX(surface->height >> 1, 1);
+	struct cg_surface_t * result = cg_surface_create(width, height);
+	for(int y = 0; y < height; y++)
+	{
+		uint32_t * r0 = (uint32_t *)((uint8_t *)surface->pixels + CG_MIN(y << 1, surface->height - 1) * surface->stride);
+		uint32_t * r1 = (uint32_t *)((uint8_t *)surface->pixels + CG_MIN((y << 1) + 1, surface->height - 1) * surface->stride);
+		uint32_t * d = (uint32_t *)((uint8_t *)result->pixels + y * result->stride);
+		for(int x = 0; x < width; x++)
+		{
+			int x0 = CG_MIN(x << 1, surface->width - 1);
+			int x1 = CG_MIN((x << 1) + 1, surface->width - 1);
+			uint32_t p0 = r0[x0], p1 = r0[x1], p2 = r1[x0], p3 = r1[x1];
+			uint32_t rb = (p0 & 0x00ff00ff) + (p1 & 0x00ff00ff) + (p2 & 0x00ff00ff) + (p3 & 0x00ff00ff) + 0x00020002;
+			uint32_t ag = ((p0 >> 8) & 0x00ff00ff) + ((p1 >> 8) & 0x00ff00ff) + ((p2 >> 8) & 0x00ff00ff) + ((p3 >> 8) & 0x00ff00ff) + 0x00020002;
+			d[x] = ((rb >> 2) & 0x00ff00ff) | (((ag >> 2) & 0x00ff00ff) << 8);
+		}
+	}
+	return result;
+}
+
+static void cg_texture_build_levels(struct cg_texture_t * texture)
+{
+	struct cg_surface_t * surface = texture->surface;
+	while((surface->width > 1) || (surface->height > 1))
+	{
+		texture->levels = realloc(texture->levels, (size_t)(texture->nlevel + 1) * sizeof(struct cg_surface_t *));
+		surface = cg_surface_downsample(surface);
+		texture->levels[texture->nlevel++] = surface;
+	}
+	texture->generation = texture->surface->generation;
+}
+
+static int cg_texture_level(struct cg_matrix_t * m, int nlevel)
+{
+	double sx = m->a * m->a + m->c * m->c;
+	double sy = m->b * m->b + m->d * m->d;
+	double scale = CG_MIN(sx, sy);
+	int level = 0;
+	while((scale >= 4.0) && (level < nlevel))
+	{
+		scale *= 0.25;
+		level++;
+	}
+	return level;
+}
+
+static void cg_texture_update(struct cg_texture_t * texture, struct cg_matrix_t * matrix)
+{
+	if(texture->levels && (texture->generation != texture->surface->generation))
+		cg_texture_clear_levels(texture);
+	if(texture->mipmap && !texture->levels)
+	{
+		struct cg_matrix_t m;
+		cg_matrix_multiply(&m, &texture->matrix, matrix);
+		cg_matrix_invert(&m);
+		if(cg_texture_level(&m, 1) > 0)
+			cg_texture_build_levels(texture);
+	}
+}
+
 void cg_texture_destroy(struct cg_texture_t * texture)
 {
 	if(texture)
 	{
 		if(--texture->ref == 0)
 		{
+			cg_texture_clear_levels(texture);
 			cg_surface_destroy(texture->surface);
 			free(texture);
 		}
@@ -1267,6 +2279,17 @@ void cg_texture_set_type(struct cg_texture_t * texture, enum cg_texture_type_t t
 	texture->type = type;
 }
 
+void cg_texture_set_filter(struct cg_texture_t * texture, enum cg_texture_filter_t filter)
+{
+	texture->filter = filter;
+}
+
+void cg_texture_set_mipmap(struct cg_texture_t * texture, int mipmap)
+{
+	cg_texture_clear_levels(texture);
+	texture->mipmap = mipmap ? 1 : 0;
+}
+
 void cg_texture_set_matrix(struct cg_texture_t * texture, struct cg_matrix_t * m)
 {
 	memcpy(&texture->matrix, m, sizeof(struct cg_matrix_t));
@@ -1277,6 +2300,7 @@ void cg_texture_set_surface(struct cg_texture_t * texture, struct cg_surface_t *
 	surface = cg_surface_reference(surface);
 	cg_surface_destroy(texture->surface);
 	texture->surface = surface;
+	cg_texture_clear_levels(texture);
 }
 
 void cg_texture_set_opacity(struct cg_texture_t * texture, double opacity)
@@ -1404,7 +2428,7 @@ struct cg_texture_t * cg_paint_get_texture(struct cg_paint_t * paint)
 struct cg_gradient_data_t {
 	enum cg_spread_method_t spread;
 	struct cg_matrix_t matrix;
-	uint32_t colortable[1024];
+	const uint32_t * colortable;
 	union {
 		struct {
 			double x1, y1;
@@ -1423,6 +2447,7 @@ struct cg_texture_data_t {
 	int height;
 	int stride;
 	int alpha;
+	int tiled;
 	void * pixels;
 };
 
@@ -1532,127 +2557,576 @@ static inline uint32_t gradient_pixel(struct cg_gradient_data_t * gradient, doub
 	return gradient->colortable[gradient_clamp(gradient, ipos)];
 }
 
-static inline void fetch_linear_gradient(uint32_t * buffer, struct cg_linear_gradient_values_t * v, struct cg_gradient_data_t * gradient, int y, int x, int length)
+static void __cg_gradient_fetch_linear(uint32_t * buffer, struct cg_gradient_data_t * gradient, int t, int inc, int length)
 {
-	double t, inc;
-	double rx = 0, ry = 0;
-
-	if(v->l == 0.0)
-	{
-		t = inc = 0;
-	}
-	else
-	{
-		rx = gradient->matrix.c * (y + 0.5) + gradient->matrix.a * (x + 0.5) + gradient->matrix.tx;
-		ry = gradient->matrix.d * (y + 0.5) + gradient->matrix.b * (x + 0.5) + gradient->matrix.ty;
-		t = v->dx * rx + v->dy * ry + v->off;
-		inc = v->dx * gradient->matrix.a + v->dy * gradient->matrix.b;
-		t *= (1024 - 1);
-		inc *= (1024 - 1);
-	}
-	uint32_t * end = buffer + length;
-	if((inc > -1e-5) && (inc < 1e-5))
-	{
-		cg_memfill32(buffer, gradient_pixel_fixed(gradient, (int)(t * FIXPT_SIZE)), length);
-	}
-	else
+	const uint32_t * colortable = gradient->colortable;
+	int i, ipos;
+	switch(gradient->spread)
 	{
-		if(t + inc * length < (double)(INT_MAX >> (FIXPT_BITS + 1)) && t + inc * length > (double)(INT_MIN >> (FIXPT_BITS + 1)))
+	case CG_SPREAD_METHOD_REFLECT:
+		for(i = 0; i < length; i++, t += inc)
 		{
-			int t_fixed = (int)(t * FIXPT_SIZE);
-			int inc_fixed = (int)(inc * FIXPT_SIZE);
-			while(buffer < end)
-			{
-				*buffer = gradient_pixel_fixed(gradient, t_fixed);
-				t_fixed += inc_fixed;
-				++buffer;
-			}
+			ipos = ((t + (FIXPT_SIZE / 2)) >> FIXPT_BITS) & 2047;
+			buffer[i] = colortable[(ipos >= 1024) ? 2047 - ipos : ipos];
 		}
-		else
+		break;
+	case CG_SPREAD_METHOD_REPEAT:
+		for(i = 0; i < length; i++, t += inc)
+			buffer[i] = colortable[((t + (FIXPT_SIZE / 2)) >> FIXPT_BITS) & 1023];
+		break;
+	default:
+		for(i = 0; i < length; i++, t += inc)
 		{
-			while(buffer < end)
-			{
-				*buffer = gradient_pixel(gradient, t / 1024);
-				t += inc;
-				++buffer;
-			}
+			ipos = (t + (FIXPT_SIZE / 2)) >> FIXPT_BITS;
+			buffer[i] = colortable[CG_CLAMP(ipos, 0, 1023)];
 		}
+		break;
 	}
 }
 
-static inline void fetch_radial_gradient(uint32_t * buffer, struct cg_radial_gradient_values_t * v, struct cg_gradient_data_t * gradient, int y, int x, int length)
+static void __cg_gradient_fetch_radial(uint32_t * buffer, struct cg_gradient_data_t * gradient, const double * det, const double * b, int length, double dr, int extended)
 {
-	if(v->a == 0.0)
-	{
-		cg_memfill32(buffer, 0, length);
-		return;
-	}
-
-	double rx = gradient->matrix.c * (y + 0.5) + gradient->matrix.tx + gradient->matrix.a * (x + 0.5);
-	double ry = gradient->matrix.d * (y + 0.5) + gradient->matrix.ty + gradient->matrix.b * (x + 0.5);
-	rx -= gradient->radial.fx;
-	ry -= gradient->radial.fy;
-
-	double inv_a = 1.0 / (2.0 * v->a);
-	double delta_rx = gradient->matrix.a;
-	double delta_ry = gradient->matrix.b;
-
-	double b = 2 * (v->dr * gradient->radial.fr + rx * v->dx + ry * v->dy);
-	double delta_b = 2 * (delta_rx * v->dx + delta_ry * v->dy);
-	double b_delta_b = 2 * b * delta_b;
-	double delta_b_delta_b = 2 * delta_b * delta_b;
-
-	double bb = b * b;
-	double delta_bb = delta_b * delta_b;
-
-	b *= inv_a;
-	delta_b *= inv_a;
-
-	double rxrxryry = rx * rx + ry * ry;
-	double delta_rxrxryry = delta_rx * delta_rx + delta_ry * delta_ry;
-	double rx_plus_ry = 2 * (rx * delta_rx + ry * delta_ry);
-	double delta_rx_plus_ry = 2 * delta_rxrxryry;
-
-	inv_a *= inv_a;
-
-	double det = (bb - 4 * v->a * (v->sqrfr - rxrxryry)) * inv_a;
-	double delta_det = (b_delta_b + delta_bb + 4 * v->a * (rx_plus_ry + delta_rxrxryry)) * inv_a;
-	double delta_delta_det = (delta_b_delta_b + 4 * v->a * delta_rx_plus_ry) * inv_a;
-
-	uint32_t * end = buffer + length;
-	if(v->extended)
+	double fr = gradient->radial.fr;
+	for(int i = 0; i < length; i++)
 	{
-		while(buffer < end)
+		if(extended)
 		{
 			uint32_t result = 0;
-			if(det >= 0)
+			if(det[i] >= 0)
 			{
-				double w = sqrt(det) - b;
-				if(gradient->radial.fr + v->dr * w >= 0)
+				double w = sqrt(det[i]) - b[i];
+				if(fr + dr * w >= 0)
 					result = gradient_pixel(gradient, w);
 			}
-			*buffer = result;
-			det += delta_det;
-			delta_det += delta_delta_det;
-			b += delta_b;
-			++buffer;
+			buffer[i] = result;
 		}
-	}
-	else
-	{
-		while(buffer < end)
+		else
 		{
-			*buffer++ = gradient_pixel(gradient, sqrt(det) - b);
-			det += delta_det;
-			delta_det += delta_delta_det;
-			b += delta_b;
+			buffer[i] = gradient_pixel(gradient, sqrt(det[i]) - b[i]);
 		}
 	}
 }
 
-static void __cg_comp_solid_source(uint32_t * dst, int len, uint32_t color, uint32_t alpha)
+#ifdef CG_SIMD_X86
+
+struct cg_gradient_spread_t {
+	int lo;
+	int hi;
+	int mask;
+	int reflect;
+};
+
+static inline void cg_gradient_spread_init(struct cg_gradient_spread_t * s, enum cg_spread_method_t spread)
 {
-	if(alpha == 255)
+	s->lo = INT_MIN;
+	s->hi = INT_MAX;
+	s->mask = -1;
+	s->reflect = 0;
+	switch(spread)
+	{
+	case CG_SPREAD_METHOD_REFLECT:
+		s->mask = 2047;
+		s->reflect = 2047;
+		break;
+	case CG_SPREAD_METHOD_REPEAT:
+		s->mask = 1023;
+		break;
+	default:
+		s->lo = 0;
+		s->hi = 1023;
+		break;
+	}
+}
+
+CG_TARGET_SSE2 static inline __m128i cg_gradient_clamp_sse2(__m128i ipos, __m128i lo, __m128i hi, __m128i mask, __m128i reflect)
+{
+	__m128i m = _mm_cmpgt_epi32(lo, ipos);
+	ipos = _mm_or_si128(_mm_and_si128(m, lo), _mm_andnot_si128(m, ipos));
+	m = _mm_cmpgt_epi32(ipos, hi);
+	ipos = _mm_or_si128(_mm_and_si128(m, hi), _mm_andnot_si128(m, ipos));
+	ipos = _mm_and_si128(ipos, mask);
+	m = _mm_cmpgt_epi32(ipos, _mm_set1_epi32(1023));
+	return _mm_xor_si128(ipos, _mm_and_si128(m, reflect));
+}
+
+CG_TARGET_SSE2 static inline void cg_gradient_gather_sse2(uint32_t * buffer, const uint32_t * colortable, __m128i ipos)
+{
+	int index[4];
+	_mm_storeu_si128((__m128i *)index, ipos);
+	buffer[0] = colortable[index[0]];
+	buffer[1] = colortable[index[1]];
+	buffer[2] = colortable[index[2]];
+	buffer[3] = colortable[index[3]];
+}
+
+CG_TARGET_SSE2 static void cg_gradient_fetch_linear_sse2(uint32_t * buffer, struct cg_gradient_data_t * gradient, int t, int inc, int length)
+{
+	struct cg_gradient_spread_t s;
+	cg_gradient_spread_init(&s, gradient->spread);
+	__m128i lo = _mm_set1_epi32(s.lo);
+	__m128i hi = _mm_set1_epi32(s.hi);
+	__m128i mask = _mm_set1_epi32(s.mask);
+	__m128i reflect = _mm_set1_epi32(s.reflect);
+	__m128i half = _mm_set1_epi32(FIXPT_SIZE / 2);
+	__m128i vt = _mm_setr_epi32(t, t + inc, t + inc * 2, t + inc * 3);
+	__m128i vinc = _mm_set1_epi32(inc * 4);
+	int i = 0;
+	for(; i + 4 <= length; i += 4)
+	{
+		__m128i ipos = _mm_srai_epi32(_mm_add_epi32(vt, half), FIXPT_BITS);
+		cg_gradient_gather_sse2(buffer + i, gradient->colortable, cg_gradient_clamp_sse2(ipos, lo, hi, mask, reflect));
+		vt = _mm_add_epi32(vt, vinc);
+	}
+	__cg_gradient_fetch_linear(buffer + i, gradient, t + inc * i, inc, length - i);
+}
+
+CG_TARGET_SSE2 static void cg_gradient_fetch_radial_sse2(uint32_t * buffer, struct cg_gradient_data_t * gradient, const double * det, const double * b, int length, double dr, int extended)
+{
+	struct cg_gradient_spread_t s;
+	cg_gradient_spread_init(&s, gradient->spread);
+	__m128i lo = _mm_set1_epi32(s.lo);
+	__m128i hi = _mm_set1_epi32(s.hi);
+	__m128i mask = _mm_set1_epi32(s.mask);
+	__m128i reflect = _mm_set1_epi32(s.reflect);
+	__m128d scale = _mm_set1_pd(1024 - 1);
+	__m128d half = _mm_set1_pd(0.5);
+	__m128d zero = _mm_setzero_pd();
+	__m128d fr = _mm_set1_pd(gradient->radial.fr);
+	__m128d vdr = _mm_set1_pd(dr);
+	int i = 0;
+	for(; i + 4 <= length; i += 4)
+	{
+		__m128d d0 = _mm_loadu_pd(det + i);
+		__m128d d1 = _mm_loadu_pd(det + i + 2);
+		__m128d w0 = _mm_sub_pd(_mm_sqrt_pd(d0), _mm_loadu_pd(b + i));
+		__m128d w1 = _mm_sub_pd(_mm_sqrt_pd(d1), _mm_loadu_pd(b + i + 2));
+		__m128i i0 = _mm_cvttpd_epi32(_mm_add_pd(_mm_mul_pd(w0, scale), half));
+		__m128i i1 = _mm_cvttpd_epi32(_mm_add_pd(_mm_mul_pd(w1, scale), half));
+		cg_gradient_gather_sse2(buffer + i, gradient->colortable, cg_gradient_clamp_sse2(_mm_unpacklo_epi64(i0, i1), lo, hi, mask, reflect));
+		if(extended)
+		{
+			__m128d m0 = _mm_and_pd(_mm_cmpge_pd(d0, zero), _mm_cmpge_pd(_mm_add_pd(fr, _mm_mul_pd(vdr, w0)), zero));
+			__m128d m1 = _mm_and_pd(_mm_cmpge_pd(d1, zero), _mm_cmpge_pd(_mm_add_pd(fr, _mm_mul_pd(vdr, w1)), zero));
+			__m128i k = _mm_castps_si128(_mm_shuffle_ps(_mm_castpd_ps(m0), _mm_castpd_ps(m1), _MM_SHUFFLE(2, 0, 2, 0)));
+			__m128i * p = (__m128i *)(buffer + i);
+			_mm_storeu_si128(p, _mm_and_si128(_mm_loadu_si128(p), k));
+		}
+	}
+	__cg_gradient_fetch_radial(buffer + i, gradient, det + i, b + i, length - i, dr, extended);
+}
+
+CG_TARGET_AVX2 static inline __m256i cg_gradient_clamp_avx2(__m256i ipos, __m256i lo, __m256i hi, __m256i mask, __m256i reflect)
+{
+	ipos = _mm256_and_si256(_mm256_min_epi32(_mm256_max_epi32(ipos, lo), hi), mask);
+	__m256i m = _mm256_cmpgt_epi32(ipos, _mm256_set1_epi32(1023));
+	return _mm256_xor_si256(ipos, _mm256_and_si256(m, reflect));
+}
+
+CG_TARGET_AVX2 static void cg_gradient_fetch_linear_avx2(uint32_t * buffer, struct cg_gradient_data_t * gradient, int t, int inc, int length)
+{
+	struct cg_gradient_spread_t s;
+	cg_gradient_spread_init(&s, gradient->spread);
+	__m256i lo = _mm256_set1_epi32(s.lo);
+	__m256i hi = _mm256_set1_epi32(s.hi);
+	__m256i mask = _mm256_set1_epi32(s.mask);
+	__m256i reflect = _mm256_set1_epi32(s.reflect);
+	__m256i half = _mm256_set1_epi32(FIXPT_SIZE / 2);
+	__m256i vt = _mm256_add_epi32(_mm256_set1_epi32(t), _mm256_mullo_epi32(_mm256_set1_epi32(inc), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+	__m256i vinc = _mm256_set1_epi32(inc * 8);
+	int i = 0;
+	for(; i + 8 <= length; i += 8)
+	{
+		__m256i ipos = cg_gradient_clamp_avx2(_mm256_srai_epi32(_mm256_add_epi32(vt, half), FIXPT_BITS), lo, hi, mask, reflect);
+		_mm256_storeu_si256((__m256i *)(buffer + i), _mm256_i32gather_epi32((const int *)gradient->colortable, ipos, 4));
+		vt = _mm256_add_epi32(vt, vinc);
+	}
+	_mm256_zeroupper();
+	__cg_gradient_fetch_linear(buffer + i, gradient, t + inc * i, inc, length - i);
+}
+
+CG_TARGET_AVX2 static void cg_gradient_fetch_radial_avx2(uint32_t * buffer, struct cg_gradient_data_t * gradient, const double * det, const double * b, int length, double dr, int extended)
+{
+	struct cg_gradient_spread_t s;
+	cg_gradient_spread_init(&s, gradient->spread);
+	__m256i lo = _mm256_set1_epi32(s.lo);
+	__m256i hi = _mm256_set1_epi32(s.hi);
+	__m256i mask = _mm256_set1_epi32(s.mask);
+	__m256i reflect = _mm256_set1_epi32(s.reflect);
+	__m256i pack = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	__m256d scale = _mm256_set1_pd(1024 - 1);
+	__m256d half = _mm256_set1_pd(0.5);
+	__m256d zero = _mm256_setzero_pd();
+	__m256d fr = _mm256_set1_pd(gradient->radial.fr);
+	__m256d vdr = _mm256_set1_pd(dr);
+	int i = 0;
+	for(; i + 8 <= length; i += 8)
+	{
+		__m256d d0 = _mm256_loadu_pd(det + i);
+		__m256d d1 = _mm256_loadu_pd(det + i + 4);
+		__m256d w0 = _mm256_sub_pd(_mm256_sqrt_pd(d0), _mm256_loadu_pd(b + i));
+		__m256d w1 = _mm256_sub_pd(_mm256_sqrt_pd(d1), _mm256_loadu_pd(b + i + 4));
+		__m128i i0 = _mm256_cvttpd_epi32(_mm256_add_pd(_mm256_mul_pd(w0, scale), half));
+		__m128i i1 = _mm256_cvttpd_epi32(_mm256_add_pd(_mm256_mul_pd(w1, scale), half));
+		__m256i ipos = cg_gradient_clamp_avx2(_mm256_inserti128_si256(_mm256_castsi128_si256(i0), i1, 1), lo, hi, mask, reflect);
+		__m256i result = _mm256_i32gather_epi32((const int *)gradient->colortable, ipos, 4);
+		if(extended)
+		{
+			__m256d m0 = _mm256_and_pd(_mm256_cmp_pd(d0, zero, _CMP_GE_OQ), _mm256_cmp_pd(_mm256_add_pd(fr, _mm256_mul_pd(vdr, w0)), zero, _CMP_GE_OQ));
+			__m256d m1 = _mm256_and_pd(_mm256_cmp_pd(d1, zero, _CMP_GE_OQ), _mm256_cmp_pd(_mm256_add_pd(fr, _mm256_mul_pd(vdr, w1)), zero, _CMP_GE_OQ));
+			__m128i k0 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(m0), pack));
+			__m128i k1 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(m1), pack));
+			result = _mm256_and_si256(result, _mm256_inserti128_si256(_mm256_castsi128_si256(k0), k1, 1));
+		}
+		_mm256_storeu_si256((__m256i *)(buffer + i), result);
+	}
+	_mm256_zeroupper();
+	__cg_gradient_fetch_radial(buffer + i, gradient, det + i, b + i, length - i, dr, extended);
+}
+
+#endif
+
+typedef void (*cg_gradient_fetch_linear_function_t)(uint32_t * buffer, struct cg_gradient_data_t * gradient, int t, int inc, int length);
+typedef void (*cg_gradient_fetch_radial_function_t)(uint32_t * buffer, struct cg_gradient_data_t * gradient, const double * det, const double * b, int length, double dr, int extended);
+static cg_gradient_fetch_linear_function_t cg_gradient_fetch_linear = __cg_gradient_fetch_linear;
+static cg_gradient_fetch_radial_function_t cg_gradient_fetch_radial = __cg_gradient_fetch_radial;
+
+#define FIXED_SCALE (1 << 16)
+
+static short cg_bicubic_weights[256][4];
+
+static void cg_bicubic_init(void)
+{
+	for(int i = 0; i < 256; i++)
+	{
+		double t = i / 256.0;
+		double t2 = t * t;
+		double t3 = t2 * t;
+		short w0 = (short)floor((-0.5 * t3 + t2 - 0.5 * t) * 16384 + 0.5);
+		short w2 = (short)floor((-1.5 * t3 + 2.0 * t2 + 0.5 * t) * 16384 + 0.5);
+		short w3 = (short)floor((0.5 * t3 - 0.5 * t2) * 16384 + 0.5);
+		cg_bicubic_weights[i][0] = w0;
+		cg_bicubic_weights[i][1] = (short)(16384 - w0 - w2 - w3);
+		cg_bicubic_weights[i][2] = w2;
+		cg_bicubic_weights[i][3] = w3;
+	}
+}
+
+static inline int cg_texture_wrap(int v, int size)
+{
+	v %= size;
+	return (v < 0) ? v + size : v;
+}
+
+static inline uint32_t cg_texture_texel(struct cg_texture_data_t * texture, int x, int y)
+{
+	if(texture->tiled)
+	{
+		x = cg_texture_wrap(x, texture->width);
+		y = cg_texture_wrap(y, texture->height);
+	}
+	else if(((unsigned int)x >= (unsigned int)texture->width) || ((unsigned int)y >= (unsigned int)texture->height))
+		return 0;
+	return ((uint32_t *)(texture->pixels + y * texture->stride))[x];
+}
+
+static inline void cg_texture_texels(struct cg_texture_data_t * texture, int x, int y, int n, uint32_t * texels)
+{
+	if((x >= 0) && (y >= 0) && (x <= texture->width - n) && (y <= texture->height - n))
+	{
+		uint32_t * row = (uint32_t *)(texture->pixels + y * texture->stride) + x;
+		for(int j = 0; j < n; j++)
+		{
+			for(int i = 0; i < n; i++)
+				texels[j * n + i] = row[i];
+			row = (uint32_t *)((uint8_t *)row + texture->stride);
+		}
+	}
+	else
+	{
+		for(int j = 0; j < n; j++)
+		{
+			for(int i = 0; i < n; i++)
+				texels[j * n + i] = cg_texture_texel(texture, x + i, y + j);
+		}
+	}
+}
+
+static inline uint32_t cg_interpolate_256(uint32_t x, uint32_t a, uint32_t y, uint32_t b)
+{
+	uint32_t t = (x & 0xff00ff) * a + (y & 0xff00ff) * b;
+	t = (t >> 8) & 0xff00ff;
+	x = (((x >> 8) & 0xff00ff) * a + ((y >> 8) & 0xff00ff) * b) & 0xff00ff00;
+	return x | t;
+}
+
+static inline uint32_t cg_bicubic_pixel(const uint32_t * texels, const short * wx, const short * wy)
+{
+	int c[4];
+	for(int k = 0; k < 4; k++)
+	{
+		int shift = k * 8;
+		int v = 0;
+		for(int j = 0; j < 4; j++)
+		{
+			const uint32_t * p = texels + j * 4;
+			int r = wx[0] * (int)((p[0] >> shift) & 0xff) + wx[1] * (int)((p[1] >> shift) & 0xff) + wx[2] * (int)((p[2] >> shift) & 0xff) + wx[3] * (int)((p[3] >> shift) & 0xff);
+			v += wy[j] * ((r + 8192) >> 14);
+		}
+		c[k] = CG_CLAMP((v + 8192) >> 14, 0, 255);
+	}
+	int a = c[3];
+	return ((uint32_t)a << 24) | ((uint32_t)CG_MIN(c[2], a) << 16) | ((uint32_t)CG_MIN(c[1], a) << 8) | (uint32_t)CG_MIN(c[0], a);
+}
+
+static void __cg_texture_fetch_bilinear(uint32_t * buffer, struct cg_texture_data_t * texture, int x, int y, int fdx, int fdy, int length)
+{
+	uint32_t t[4];
+	x -= FIXED_SCALE / 2;
+	y -= FIXED_SCALE / 2;
+	for(int i = 0; i < length; i++, x += fdx, y += fdy)
+	{
+		uint32_t distx = (x >> 8) & 0xff;
+		uint32_t disty = (y >> 8) & 0xff;
+		cg_texture_texels(texture, x >> 16, y >> 16, 2, t);
+		uint32_t top = cg_interpolate_256(t[0], 256 - distx, t[1], distx);
+		uint32_t bottom = cg_interpolate_256(t[2], 256 - distx, t[3], distx);
+		buffer[i] = cg_interpolate_256(top, 256 - disty, bottom, disty);
+	}
+}
+
+static void __cg_texture_fetch_bicubic(uint32_t * buffer, struct cg_texture_data_t * texture, int x, int y, int fdx, int fdy, int length)
+{
+	uint32_t t[16];
+	x -= FIXED_SCALE / 2;
+	y -= FIXED_SCALE / 2;
+	for(int i = 0; i < length; i++, x += fdx, y += fdy)
+	{
+		cg_texture_texels(texture, (x >> 16) - 1, (y >> 16) - 1, 4, t);
+		buffer[i] = cg_bicubic_pixel(t, cg_bicubic_weights[(x >> 8) & 0xff], cg_bicubic_weights[(y >> 8) & 0xff]);
+	}
+}
+
+#ifdef CG_SIMD_X86
+
+CG_TARGET_SSE2 static inline __m128i cg_weights_sse2(uint32_t w0, uint32_t w1, uint32_t w2, uint32_t w3)
+{
+	__m128i w = _mm_setr_epi32((int)w0, (int)w1, (int)w2, (int)w3);
+	return _mm_or_si128(w, _mm_slli_epi32(w, 16));
+}
+
+CG_TARGET_SSE2 static inline __m128i cg_interpolate_256_sse2(__m128i x, __m128i a, __m128i y, __m128i b)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i alo = _mm_unpacklo_epi32(a, a);
+	__m128i ahi = _mm_unpackhi_epi32(a, a);
+	__m128i blo = _mm_unpacklo_epi32(b, b);
+	__m128i bhi = _mm_unpackhi_epi32(b, b);
+	__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(x, zero), alo), _mm_mullo_epi16(_mm_unpacklo_epi8(y, zero), blo));
+	__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(x, zero), ahi), _mm_mullo_epi16(_mm_unpackhi_epi8(y, zero), bhi));
+	return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+}
+
+CG_TARGET_SSE2 static void cg_texture_fetch_bilinear_sse2(uint32_t * buffer, struct cg_texture_data_t * texture, int x, int y, int fdx, int fdy, int length)
+{
+	__m128i top[4], bottom[4];
+	uint32_t dx[4], dy[4];
+	__m128i v256 = _mm_set1_epi16(256);
+	int i = 0;
+	for(; i + 4 <= length; i += 4)
+	{
+		int u = x - FIXED_SCALE / 2;
+		int v = y - FIXED_SCALE / 2;
+		for(int k = 0; k < 4; k++, u += fdx, v += fdy)
+		{
+			int px = u >> 16;
+			int py = v >> 16;
+			dx[k] = (u >> 8) & 0xff;
+			dy[k] = (v >> 8) & 0xff;
+			if((px >= 0) && (py >= 0) && (px < texture->width - 1) && (py < texture->height - 1))
+			{
+				uint32_t * row = (uint32_t *)(texture->pixels + py * texture->stride) + px;
+				top[k] = _mm_loadl_epi64((__m128i *)row);
+				bottom[k] = _mm_loadl_epi64((__m128i *)((uint8_t *)row + texture->stride));
+			}
+			else
+			{
+				uint32_t t[4];
+				cg_texture_texels(texture, px, py, 2, t);
+				top[k] = _mm_setr_epi32((int)t[0], (int)t[1], 0, 0);
+				bottom[k] = _mm_setr_epi32((int)t[2], (int)t[3], 0, 0);
+			}
+		}
+		__m128 t01 = _mm_castsi128_ps(_mm_unpacklo_epi64(top[0], top[1]));
+		__m128 t23 = _mm_castsi128_ps(_mm_unpacklo_epi64(top[2], top[3]));
+		__m128 b01 = _mm_castsi128_ps(_mm_unpacklo_epi64(bottom[0], bottom[1]));
+		__m128 b23 = _mm_castsi128_ps(_mm_unpacklo_epi64(bottom[2], bottom[3]));
+		__m128i tl = _mm_castps_si128(_mm_shuffle_ps(t01, t23, _MM_SHUFFLE(2, 0, 2, 0)));
+		__m128i tr = _mm_castps_si128(_mm_shuffle_ps(t01, t23, _MM_SHUFFLE(3, 1, 3, 1)));
+		__m128i bl = _mm_castps_si128(_mm_shuffle_ps(b01, b23, _MM_SHUFFLE(2, 0, 2, 0)));
+		__m128i br = _mm_castps_si128(_mm_shuffle_ps(b01, b23, _MM_SHUFFLE(3, 1, 3, 1)));
+		__m128i wx = cg_weights_sse2(dx[0], dx[1], dx[2], dx[3]);
+		__m128i wy = cg_weights_sse2(dy[0], dy[1], dy[2], dy[3]);
+		__m128i iwx = _mm_sub_epi16(v256, wx);
+		__m128i iwy = _mm_sub_epi16(v256, wy);
+		__m128i t = cg_interpolate_256_sse2(tl, iwx, tr, wx);
+		__m128i b = cg_interpolate_256_sse2(bl, iwx, br, wx);
+		_mm_storeu_si128((__m128i *)(buffer + i), cg_interpolate_256_sse2(t, iwy, b, wy));
+		x += fdx * 4;
+		y += fdy * 4;
+	}
+	__cg_texture_fetch_bilinear(buffer + i, texture, x, y, fdx, fdy, length - i);
+}
+
+CG_TARGET_SSE2 static inline __m128i cg_bicubic_madd_sse2(__m128i p, __m128i w01, __m128i w23)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i lo = _mm_unpacklo_epi8(p, zero);
+	__m128i hi = _mm_unpackhi_epi8(p, zero);
+	lo = _mm_unpacklo_epi16(lo, _mm_srli_si128(lo, 8));
+	hi = _mm_unpacklo_epi16(hi, _mm_srli_si128(hi, 8));
+	return _mm_add_epi32(_mm_madd_epi16(lo, w01), _mm_madd_epi16(hi, w23));
+}
+
+CG_TARGET_SSE2 static void cg_texture_fetch_bicubic_sse2(uint32_t * buffer, struct cg_texture_data_t * texture, int x, int y, int fdx, int fdy, int length)
+{
+	uint32_t t[16];
+	__m128i round = _mm_set1_epi32(8192);
+	x -= FIXED_SCALE / 2;
+	y -= FIXED_SCALE / 2;
+	for(int i = 0; i < length; i++, x += fdx, y += fdy)
+	{
+		const short * wx = cg_bicubic_weights[(x >> 8) & 0xff];
+		const short * wy = cg_bicubic_weights[(y >> 8) & 0xff];
+		__m128i wx01 = _mm_set1_epi32((int)(((uint32_t)(uint16_t)wx[1] << 16) | (uint16_t)wx[0]));
+		__m128i wx23 = _mm_set1_epi32((int)(((uint32_t)(uint16_t)wx[3] << 16) | (uint16_t)wx[2]));
+		__m128i wy01 = _mm_set1_epi32((int)(((uint32_t)(uint16_t)wy[1] << 16) | (uint16_t)wy[0]));
+		__m128i wy23 = _mm_set1_epi32((int)(((uint32_t)(uint16_t)wy[3] << 16) | (uint16_t)wy[2]));
+		cg_texture_texels(texture, (x >> 16) - 1, (y >> 16) - 1, 4, t);
+		__m128i r0 = _mm_srai_epi32(_mm_add_epi32(cg_bicubic_madd_sse2(_mm_loadu_si128((__m128i *)(t + 0)), wx01, wx23), round), 14);
+		__m128i r1 = _mm_srai_epi32(_mm_add_epi32(cg_bicubic_madd_sse2(_mm_loadu_si128((__m128i *)(t + 4)), wx01, wx23), round), 14);
+		__m128i r2 = _mm_srai_epi32(_mm_add_epi32(cg_bicubic_madd_sse2(_mm_loadu_si128((__m128i *)(t + 8)), wx01, wx23), round), 14);
+		__m128i r3 = _mm_srai_epi32(_mm_add_epi32(cg_bicubic_madd_sse2(_mm_loadu_si128((__m128i *)(t + 12)), wx01, wx23), round), 14);
+		__m128i r01 = _mm_packs_epi32(r0, r1);
+		__m128i r23 = _mm_packs_epi32(r2, r3);
+		r01 = _mm_unpacklo_epi16(r01, _mm_srli_si128(r01, 8));
+		r23 = _mm_unpacklo_epi16(r23, _mm_srli_si128(r23, 8));
+		__m128i c = _mm_add_epi32(_mm_madd_epi16(r01, wy01), _mm_madd_epi16(r23, wy23));
+		c = _mm_srai_epi32(_mm_add_epi32(c, round), 14);
+		c = _mm_packs_epi32(c, c);
+		uint32_t p = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(c, c));
+		uint32_t a = p >> 24;
+		buffer[i] = (a << 24) | (CG_MIN((p >> 16) & 0xff, a) << 16) | (CG_MIN((p >> 8) & 0xff, a) << 8) | CG_MIN(p & 0xff, a);
+	}
+}
+
+#endif
+
+typedef void (*cg_texture_fetch_function_t)(uint32_t * buffer, struct cg_texture_data_t * texture, int x, int y, int fdx, int fdy, int length);
+static cg_texture_fetch_function_t cg_texture_fetch_bilinear = __cg_texture_fetch_bilinear;
+static cg_texture_fetch_function_t cg_texture_fetch_bicubic = __cg_texture_fetch_bicubic;
+
+static inline void fetch_linear_gradient(uint32_t * buffer, struct cg_linear_gradient_values_t * v, struct cg_gradient_data_t * gradient, int y, int x, int length)
+{
+	double t, inc;
+	double rx = 0, ry = 0;
+
+	if(v->l == 0.0)
+	{
+		t = inc = 0;
+	}
+	else
+	{
+		rx = gradient->matrix.c * (y + 0.5) + gradient->matrix.a * (x + 0.5) + gradient->matrix.tx;
+		ry = gradient->matrix.d * (y + 0.5) + gradient->matrix.b * (x + 0.5) + gradient->matrix.ty;
+		t = v->dx * rx + v->dy * ry + v->off;
+		inc = v->dx * gradient->matrix.a + v->dy * gradient->matrix.b;
+		t *= (1024 - 1);
+		inc *= (1024 - 1);
+	}
+	uint32_t * end = buffer + length;
+	if((inc > -1e-5) && (inc < 1e-5))
+	{
+		cg_memfill32(buffer, gradient_pixel_fixed(gradient, (int)(t * FIXPT_SIZE)), length);
+	}
+	else
+	{
+		if(t + inc * length < (double)(INT_MAX >> (FIXPT_BITS + 1)) && t + inc * length > (double)(INT_MIN >> (FIXPT_BITS + 1)))
+		{
+			cg_gradient_fetch_linear(buffer, gradient, (int)(t * FIXPT_SIZE), (int)(inc * FIXPT_SIZE), length);
+		}
+		else
+		{
+			while(buffer < end)
+			{
+				*buffer = gradient_pixel(gradient, t / 1024);
+				t += inc;
+				++buffer;
+			}
+		}
+	}
+}
+
+static inline void fetch_radial_gradient(uint32_t * buffer, struct cg_radial_gradient_values_t * v, struct cg_gradient_data_t * gradient, int y, int x, int length)
+{
+	if(v->a == 0.0)
+	{
+		cg_memfill32(buffer, 0, length);
+		return;
+	}
+
+	double rx = gradient->matrix.c * (y + 0.5) + gradient->matrix.tx + gradient->matrix.a * (x + 0.5);
+	double ry = gradient->matrix.d * (y + 0.5) + gradient->matrix.ty + gradient->matrix.b * (x + 0.5);
+	rx -= gradient->radial.fx;
+	ry -= gradient->radial.fy;
+
+	double inv_a = 1.0 / (2.0 * v->a);
+	double delta_rx = gradient->matrix.a;
+	double delta_ry = gradient->matrix.b;
+
+	double b = 2 * (v->dr * gradient->radial.fr + rx * v->dx + ry * v->dy);
+	double delta_b = 2 * (delta_rx * v->dx + delta_ry * v->dy);
+	double b_delta_b = 2 * b * delta_b;
+	double delta_b_delta_b = 2 * delta_b * delta_b;
+
+	double bb = b * b;
+	double delta_bb = delta_b * delta_b;
+
+	b *= inv_a;
+	delta_b *= inv_a;
+
+	double rxrxryry = rx * rx + ry * ry;
+	double delta_rxrxryry = delta_rx * delta_rx + delta_ry * delta_ry;
+	double rx_plus_ry = 2 * (rx * delta_rx + ry * delta_ry);
+	double delta_rx_plus_ry = 2 * delta_rxrxryry;
+
+	inv_a *= inv_a;
+
+	double det = (bb - 4 * v->a * (v->sqrfr - rxrxryry)) * inv_a;
+	double delta_det = (b_delta_b + delta_bb + 4 * v->a * (rx_plus_ry + delta_rxrxryry)) * inv_a;
+	double delta_delta_det = (delta_b_delta_b + 4 * v->a * delta_rx_plus_ry) * inv_a;
+
+	double dets[64];
+	double bs[64];
+	while(length > 0)
+	{
+		int l = CG_MIN(length, 64);
+		for(int i = 0; i < l; i++)
+		{
+			dets[i] = det;
+			bs[i] = b;
+			det += delta_det;
+			delta_det += delta_delta_det;
+			b += delta_b;
+		}
+		cg_gradient_fetch_radial(buffer, gradient, dets, bs, l, v->dr, v->extended);
+		buffer += l;
+		length -= l;
+	}
+}
+
+static void __cg_comp_solid_source(uint32_t * dst, int len, uint32_t color, uint32_t alpha)
+{
+	if(alpha == 255)
 	{
 		cg_memfill32(dst, color, len);
 	}
@@ -1691,19 +3165,802 @@ static void __cg_comp_solid_destination_in(uint32_t * dst, int len, uint32_t col
 	for(int i = 0; i < len; i++)
 		dst[i] = CG_BYTE_MUL(dst[i], a);
 }
-extern __typeof(__cg_comp_solid_destination_in) cg_comp_solid_destination_in __attribute__((weak, alias("__cg_comp_solid_destination_in")));
+extern __typeof(__cg_comp_solid_destination_in) cg_comp_solid_destination_in __attribute__((weak, alias("__cg_comp_solid_destination_in")));
+
+static void __cg_comp_solid_destination_out(uint32_t * dst, int len, uint32_t color, uint32_t alpha)
+{
+	uint32_t a = CG_ALPHA(~color);
+	if(alpha != 255)
+		a = CG_BYTE_MUL(a, alpha) + 255 - alpha;
+	for(int i = 0; i < len; i++)
+		dst[i] = CG_BYTE_MUL(dst[i], a);
+}
+extern __typeof(__cg_comp_solid_destination_out) cg_comp_solid_destination_out __attribute__((weak, alias("__cg_comp_solid_destination_out")));
+
+static void __cg_comp_source(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+{
+	if(alpha == 255)
+	{
+		memcpy(dst, src, (size_t)(len) * sizeof(uint32_t));
+	}
+	else
+	{
+		uint32_t ialpha = 255 - alpha;
+		for(int i = 0; i < len; i++)
+			dst[i] = interpolate_pixel(src[i], alpha, dst[i], ialpha);
+	}
+}
+extern __typeof(__cg_comp_source) cg_comp_source __attribute__((weak, alias("__cg_comp_source")));
+
+static void __cg_comp_source_over(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+{
+	uint32_t s, sia;
+	if(alpha == 255)
+	{
+		for(int i = 0; i < len; i++)
+		{
+			s = src[i];
+			if(s >= 0xff000000)
+				dst[i] = s;
+			else if(s != 0)
+			{
+				sia = CG_ALPHA(~s);
+				dst[i] = s + CG_BYTE_MUL(dst[i], sia);
+			}
+		}
+	}
+	else
+	{
+		for(int i = 0; i < len; i++)
+		{
+			s = CG_BYTE_MUL(src[i], alpha);
+			sia = CG_ALPHA(~s);
+			dst[i] = s + CG_BYTE_MUL(dst[i], sia);
+		}
+	}
+}
+extern __typeof(__cg_comp_source_over) cg_comp_source_over __attribute__((weak, alias("__cg_comp_source_over")));
+
+static void __cg_comp_destination_in(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+{
+	if(alpha == 255)
+	{
+		for(int i = 0; i < len; i++)
+			dst[i] = CG_BYTE_MUL(dst[i], CG_ALPHA(src[i]));
+	}
+	else
+	{
+		uint32_t cia = 255 - alpha;
+		uint32_t a;
+		for(int i = 0; i < len; i++)
+		{
+			a = CG_BYTE_MUL(CG_ALPHA(src[i]), alpha) + cia;
+			dst[i] = CG_BYTE_MUL(dst[i], a);
+		}
+	}
+}
+extern __typeof(__cg_comp_destination_in) cg_comp_destination_in __attribute__((weak, alias("__cg_comp_destination_in")));
+
+static void __cg_comp_destination_out(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+{
+	if(alpha == 255)
+	{
+		for(int i = 0; i < len; i++)
+			dst[i] = CG_BYTE_MUL(dst[i], CG_ALPHA(~src[i]));
+	}
+	else
+	{
+		uint32_t cia = 255 - alpha;
+		uint32_t sia;
+		for(int i = 0; i < len; i++)
+		{
+			sia = CG_BYTE_MUL(CG_ALPHA(~src[i]), alpha) + cia;
+			dst[i] = CG_BYTE_MUL(dst[i], sia);
+		}
+	}
+}
+extern __typeof(__cg_comp_destination_out) cg_comp_destination_out __attribute__((weak, alias("__cg_comp_destination_out")));
+
+static void __cg_comp_solid_source_mask(uint32_t * dst, int len, uint32_t color, const uint8_t * mask)
+{
+	for(int i = 0; i < len; i++)
+	{
+		uint32_t c = (mask[i] == 255) ? color : CG_BYTE_MUL(color, mask[i]);
+		dst[i] = c + CG_BYTE_MUL(dst[i], 255 - mask[i]);
+	}
+}
+extern __typeof(__cg_comp_solid_source_mask) cg_comp_solid_source_mask __attribute__((weak, alias("__cg_comp_solid_source_mask")));
+
+static void __cg_comp_solid_source_over_mask(uint32_t * dst, int len, uint32_t color, const uint8_t * mask)
+{
+	for(int i = 0; i < len; i++)
+	{
+		uint32_t c = (mask[i] == 255) ? color : CG_BYTE_MUL(color, mask[i]);
+		dst[i] = c + CG_BYTE_MUL(dst[i], 255 - CG_ALPHA(c));
+	}
+}
+extern __typeof(__cg_comp_solid_source_over_mask) cg_comp_solid_source_over_mask __attribute__((weak, alias("__cg_comp_solid_source_over_mask")));
+
+static inline int cg_blend_channel(int s, int d, int sa, int da, enum cg_operator_t op)
+{
+	int r;
+	switch(op)
+	{
+	case CG_OPERATOR_MULTIPLY:
+		r = CG_DIV255(s * d);
+		break;
+	case CG_OPERATOR_SCREEN:
+		return s + d - CG_DIV255(s * d);
+	case CG_OPERATOR_OVERLAY:
+		if(2 * d <= da)
+			r = 2 * CG_DIV255(s * d);
+		else
+			r = CG_DIV255(sa * da) - 2 * CG_DIV255((da - d) * (sa - s));
+		break;
+	case CG_OPERATOR_DARKEN:
+		r = CG_MIN(CG_DIV255(s * da), CG_DIV255(d * sa));
+		break;
+	case CG_OPERATOR_LIGHTEN:
+		r = CG_MAX(CG_DIV255(s * da), CG_DIV255(d * sa));
+		break;
+	case CG_OPERATOR_COLOR_DODGE:
+		if(d == 0)
+			r = 0;
+		else if(s >= sa)
+			r = CG_DIV255(sa * da);
+		else
+			r = CG_DIV255(CG_MIN(sa * da, d * sa * sa / (sa - s)));
+		break;
+	case CG_OPERATOR_COLOR_BURN:
+		if(d >= da)
+			r = CG_DIV255(sa * da);
+		else if(s == 0)
+			r = 0;
+		else
+			r = CG_DIV255(CG_MAX(sa * da - (da - d) * sa * sa / s, 0));
+		break;
+	case CG_OPERATOR_HARD_LIGHT:
+		if(2 * s <= sa)
+			r = 2 * CG_DIV255(s * d);
+		else
+			r = CG_DIV255(sa * da) - 2 * CG_DIV255((da - d) * (sa - s));
+		break;
+	case CG_OPERATOR_SOFT_LIGHT:
+		{
+			double cs = sa ? (double)s / sa : 0.0;
+			double cb = da ? (double)d / da : 0.0;
+			double b;
+			if(cs <= 0.5)
+				b = cb - (1.0 - 2.0 * cs) * cb * (1.0 - cb);
+			else
+				b = cb + (2.0 * cs - 1.0) * (((cb <= 0.25) ? ((16.0 * cb - 12.0) * cb + 4.0) * cb : sqrt(cb)) - cb);
+			r = (int)(b * sa * da / 255.0 + 0.5);
+		}
+		break;
+	case CG_OPERATOR_DIFFERENCE:
+		return s + d - 2 * CG_MIN(CG_DIV255(s * da), CG_DIV255(d * sa));
+	case CG_OPERATOR_EXCLUSION:
+		return s + d - 2 * CG_DIV255(s * d);
+	default:
+		return s;
+	}
+	return r + CG_DIV255(s * (255 - da)) + CG_DIV255(d * (255 - sa));
+}
+
+static inline uint32_t cg_blend_pixel(uint32_t s, uint32_t d, enum cg_operator_t op)
+{
+	uint32_t sa = CG_ALPHA(s);
+	uint32_t da = CG_ALPHA(d);
+	switch(op)
+	{
+	case CG_OPERATOR_CLEAR:
+		return 0;
+	case CG_OPERATOR_SRC_IN:
+		return interpolate_pixel(s, da, 0, 0);
+	case CG_OPERATOR_SRC_OUT:
+		return interpolate_pixel(s, 255 - da, 0, 0);
+	case CG_OPERATOR_SRC_ATOP:
+		return interpolate_pixel(s, da, d, 255 - sa);
+	case CG_OPERATOR_DST_OVER:
+		return d + interpolate_pixel(s, 255 - da, 0, 0);
+	case CG_OPERATOR_DST_ATOP:
+		return interpolate_pixel(d, sa, s, 255 - da);
+	case CG_OPERATOR_XOR:
+		return interpolate_pixel(s, 255 - da, d, 255 - sa);
+	case CG_OPERATOR_ADD:
+		{
+			uint32_t rb = (s & 0x00ff00ff) + (d & 0x00ff00ff);
+			uint32_t ag = ((s >> 8) & 0x00ff00ff) + ((d >> 8) & 0x00ff00ff);
+			rb = (rb | (0x01000100 - ((rb >> 8) & 0x00010001))) & 0x00ff00ff;
+			ag = (ag | (0x01000100 - ((ag >> 8) & 0x00010001))) & 0x00ff00ff;
+			return rb | (ag << 8);
+		}
+	default:
+		{
+			uint32_t r = (sa + da - CG_DIV255(sa * da)) << 24;
+			for(int i = 0; i < 24; i += 8)
+			{
+				int c = cg_blend_channel((int)((s >> i) & 0xff), (int)((d >> i) & 0xff), (int)sa, (int)da, op);
+				r |= (uint32_t)CG_CLAMP(c, 0, 255) << i;
+			}
+			return r;
+		}
+	}
+}
+
+#define CG_COMP_DEFINE(name, op) \
+static void __cg_comp_solid_##name(uint32_t * dst, int len, uint32_t color, uint32_t alpha) \
+{ \
+	uint32_t ialpha = 255 - alpha; \
+	for(int i = 0; i < len; i++) \
+	{ \
+		uint32_t r = cg_blend_pixel(color, dst[i], op); \
+		dst[i] = (alpha == 255) ? r : interpolate_pixel(r, alpha, dst[i], ialpha); \
+	} \
+} \
+extern __typeof(__cg_comp_solid_##name) cg_comp_solid_##name __attribute__((weak, alias("__cg_comp_solid_" #name))); \
+static void __cg_comp_##name(uint32_t * dst, int len, uint32_t * src, uint32_t alpha) \
+{ \
+	uint32_t ialpha = 255 - alpha; \
+	for(int i = 0; i < len; i++) \
+	{ \
+		uint32_t r = cg_blend_pixel(src[i], dst[i], op); \
+		dst[i] = (alpha == 255) ? r : interpolate_pixel(r, alpha, dst[i], ialpha); \
+	} \
+} \
+extern __typeof(__cg_comp_##name) cg_comp_##name __attribute__((weak, alias("__cg_comp_" #name)));
+
+static void __cg_comp_solid_destination(uint32_t * dst, int len, uint32_t color, uint32_t alpha)
+{
+}
+extern __typeof(__cg_comp_solid_destination) cg_comp_solid_destination __attribute__((weak, alias("__cg_comp_solid_destination")));
+
+static void __cg_comp_destination(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+{
+}
+extern __typeof(__cg_comp_destination) cg_comp_destination __attribute__((weak, alias("__cg_comp_destination")));
+
+CG_COMP_DEFINE(clear, CG_OPERATOR_CLEAR)
+CG_COMP_DEFINE(source_in, CG_OPERATOR_SRC_IN)
+CG_COMP_DEFINE(source_out, CG_OPERATOR_SRC_OUT)
+CG_COMP_DEFINE(source_atop, CG_OPERATOR_SRC_ATOP)
+CG_COMP_DEFINE(destination_over, CG_OPERATOR_DST_OVER)
+CG_COMP_DEFINE(destination_atop, CG_OPERATOR_DST_ATOP)
+CG_COMP_DEFINE(xor, CG_OPERATOR_XOR)
+CG_COMP_DEFINE(add, CG_OPERATOR_ADD)
+CG_COMP_DEFINE(multiply, CG_OPERATOR_MULTIPLY)
+CG_COMP_DEFINE(screen, CG_OPERATOR_SCREEN)
+CG_COMP_DEFINE(overlay, CG_OPERATOR_OVERLAY)
+CG_COMP_DEFINE(darken, CG_OPERATOR_DARKEN)
+CG_COMP_DEFINE(lighten, CG_OPERATOR_LIGHTEN)
+CG_COMP_DEFINE(color_dodge, CG_OPERATOR_COLOR_DODGE)
+CG_COMP_DEFINE(color_burn, CG_OPERATOR_COLOR_BURN)
+CG_COMP_DEFINE(hard_light, CG_OPERATOR_HARD_LIGHT)
+CG_COMP_DEFINE(soft_light, CG_OPERATOR_SOFT_LIGHT)
+CG_COMP_DEFINE(difference, CG_OPERATOR_DIFFERENCE)
+CG_COMP_DEFINE(exclusion, CG_OPERATOR_EXCLUSION)
+
+#ifdef CG_SIMD_X86
+
+CG_TARGET_SSE2 static inline __m128i cg_byte_mul_sse2(__m128i x, __m128i alo, __m128i ahi)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(x, zero), alo), 8);
+	__m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(x, zero), ahi), 8);
+	return _mm_packus_epi16(lo, hi);
+}
+
+CG_TARGET_SSE2 static inline __m128i cg_alpha_lo_sse2(__m128i x)
+{
+	__m128i t = _mm_unpacklo_epi8(x, _mm_setzero_si128());
+	return _mm_shufflehi_epi16(_mm_shufflelo_epi16(t, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+CG_TARGET_SSE2 static inline __m128i cg_alpha_hi_sse2(__m128i x)
+{
+	__m128i t = _mm_unpackhi_epi8(x, _mm_setzero_si128());
+	return _mm_shufflehi_epi16(_mm_shufflelo_epi16(t, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+CG_TARGET_SSE2 static inline __m128i cg_interpolate_sse2(__m128i x, __m128i a, __m128i y, __m128i b)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i half = _mm_set1_epi16(0x80);
+	__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(x, zero), a), _mm_mullo_epi16(_mm_unpacklo_epi8(y, zero), b));
+	__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(x, zero), a), _mm_mullo_epi16(_mm_unpackhi_epi8(y, zero), b));
+	lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), half), 8);
+	hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), half), 8);
+	return _mm_packus_epi16(lo, hi);
+}
+
+CG_TARGET_SSE2 static inline void cg_memfill32_sse2(uint32_t * dst, uint32_t val, int len)
+{
+	__m128i v = _mm_set1_epi32((int)val);
+	int i = 0;
+	for(; i + 16 <= len; i += 16)
+	{
+		_mm_storeu_si128((__m128i *)(dst + i), v);
+		_mm_storeu_si128((__m128i *)(dst + i + 4), v);
+		_mm_storeu_si128((__m128i *)(dst + i + 8), v);
+		_mm_storeu_si128((__m128i *)(dst + i + 12), v);
+	}
+	for(; i + 4 <= len; i += 4)
+		_mm_storeu_si128((__m128i *)(dst + i), v);
+	for(; i < len; i++)
+		dst[i] = val;
+}
+
+CG_TARGET_SSE2 static inline void cg_comp_add_mul_sse2(uint32_t * dst, int len, uint32_t color, uint32_t a)
+{
+	__m128i c = _mm_set1_epi32((int)color);
+	__m128i va = _mm_set1_epi16((short)a);
+	int i = 0;
+	for(; i + 4 <= len; i += 4)
+	{
+		__m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_add_epi32(c, cg_byte_mul_sse2(d, va, va)));
+	}
+	for(; i < len; i++)
+		dst[i] = color + CG_BYTE_MUL(dst[i], a);
+}
+
+CG_TARGET_SSE2 static inline void cg_comp_mul_sse2(uint32_t * dst, int len, uint32_t a)
+{
+	__m128i va = _mm_set1_epi16((short)a);
+	int i = 0;
+	for(; i + 4 <= len; i += 4)
+	{
+		__m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+		_mm_storeu_si128((__m128i *)(dst + i), cg_byte_mul_sse2(d, va, va));
+	}
+	for(; i < len; i++)
+		dst[i] = CG_BYTE_MUL(dst[i], a);
+}
+
+CG_TARGET_SSE2 static void cg_comp_solid_source_sse2(uint32_t * dst, int len, uint32_t color, uint32_t alpha)
+{
+	if(alpha == 255)
+		cg_memfill32_sse2(dst, color, len);
+	else
+		cg_comp_add_mul_sse2(dst, len, CG_BYTE_MUL(color, alpha), 255 - alpha);
+}
+
+CG_TARGET_SSE2 static void cg_comp_solid_source_over_sse2(uint32_t * dst, int len, uint32_t color, uint32_t alpha)
+{
+	if((alpha & CG_ALPHA(color)) == 255)
+	{
+		cg_memfill32_sse2(dst, color, len);
+	}
+	else
+	{
+		if(alpha != 255)
+			color = CG_BYTE_MUL(color, alpha);
+		cg_comp_add_mul_sse2(dst, len, color, 255 - CG_ALPHA(color));
+	}
+}
+
+CG_TARGET_SSE2 static void cg_comp_solid_destination_in_sse2(uint32_t * dst, int len, uint32_t color, uint32_t alpha)
+{
+	uint32_t a = CG_ALPHA(color);
+	if(alpha != 255)
+		a = CG_BYTE_MUL(a, alpha) + 255 - alpha;
+	cg_comp_mul_sse2(dst, len, a);
+}
+
+CG_TARGET_SSE2 static void cg_comp_solid_destination_out_sse2(uint32_t * dst, int len, uint32_t color, uint32_t alpha)
+{
+	uint32_t a = CG_ALPHA(~color);
+	if(alpha != 255)
+		a = CG_BYTE_MUL(a, alpha) + 255 - alpha;
+	cg_comp_mul_sse2(dst, len, a);
+}
+
+CG_TARGET_SSE2 static void cg_comp_source_sse2(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+{
+	if(alpha == 255)
+	{
+		memcpy(dst, src, (size_t)(len) * sizeof(uint32_t));
+	}
+	else
+	{
+		__m128i va = _mm_set1_epi16((short)alpha);
+		__m128i via = _mm_set1_epi16((short)(255 - alpha));
+		int i = 0;
+		for(; i + 4 <= len; i += 4)
+		{
+			__m128i s = _mm_loadu_si128((__m128i *)(src + i));
+			__m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+			_mm_storeu_si128((__m128i *)(dst + i), cg_interpolate_sse2(s, va, d, via));
+		}
+		__cg_comp_source(dst + i, len - i, src + i, alpha);
+	}
+}
+
+CG_TARGET_SSE2 static void cg_comp_source_over_sse2(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i ones = _mm_set1_epi32(-1);
+	__m128i v255 = _mm_set1_epi16(0xff);
+	int i = 0;
+	if(alpha == 255)
+	{
+		for(; i + 4 <= len; i += 4)
+		{
+			__m128i s = _mm_loadu_si128((__m128i *)(src + i));
+			__m128i sa = _mm_srli_epi32(s, 24);
+			__m128i opaque = _mm_cmpeq_epi32(sa, _mm_set1_epi32(0xff));
+			if(_mm_movemask_epi8(opaque) == 0xffff)
+			{
+				_mm_storeu_si128((__m128i *)(dst + i), s);
+				continue;
+			}
+			__m128i transparent = _mm_cmpeq_epi32(s, zero);
+			if(_mm_movemask_epi8(transparent) == 0xffff)
+				continue;
+			__m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+			__m128i r = _mm_add_epi32(s, cg_byte_mul_sse2(d, _mm_sub_epi16(v255, cg_alpha_lo_sse2(s)), _mm_sub_epi16(v255, cg_alpha_hi_sse2(s))));
+			r = _mm_or_si128(_mm_and_si128(transparent, d), _mm_and_si128(_mm_xor_si128(transparent, ones), r));
+			_mm_storeu_si128((__m128i *)(dst + i), r);
+		}
+	}
+	else
+	{
+		__m128i va = _mm_set1_epi16((short)alpha);
+		for(; i + 4 <= len; i += 4)
+		{
+			__m128i s = cg_byte_mul_sse2(_mm_loadu_si128((__m128i *)(src + i)), va, va);
+			__m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+			__m128i r = _mm_add_epi32(s, cg_byte_mul_sse2(d, _mm_sub_epi16(v255, cg_alpha_lo_sse2(s)), _mm_sub_epi16(v255, cg_alpha_hi_sse2(s))));
+			_mm_storeu_si128((__m128i *)(dst + i), r);
+		}
+	}
+	__cg_comp_source_over(dst + i, len - i, src + i, alpha);
+}
+
+CG_TARGET_SSE2 static void cg_comp_destination_in_sse2(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+{
+	__m128i va = _mm_set1_epi16((short)alpha);
+	__m128i vcia = _mm_set1_epi16((short)(255 - alpha));
+	int i = 0;
+	for(; i + 4 <= len; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((__m128i *)(src + i));
+		__m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+		__m128i alo = cg_alpha_lo_sse2(s);
+		__m128i ahi = cg_alpha_hi_sse2(s);
+		if(alpha != 255)
+		{
+			alo = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(alo, va), 8), vcia);
+			ahi = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(ahi, va), 8), vcia);
+		}
+		_mm_storeu_si128((__m128i *)(dst + i), cg_byte_mul_sse2(d, alo, ahi));
+	}
+	__cg_comp_destination_in(dst + i, len - i, src + i, alpha);
+}
+
+CG_TARGET_SSE2 static void cg_comp_destination_out_sse2(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+{
+	__m128i va = _mm_set1_epi16((short)alpha);
+	__m128i vcia = _mm_set1_epi16((short)(255 - alpha));
+	__m128i v255 = _mm_set1_epi16(0xff);
+	int i = 0;
+	for(; i + 4 <= len; i += 4)
+	{
+		__m128i s = _mm_loadu_si128((__m128i *)(src + i));
+		__m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+		__m128i alo = _mm_sub_epi16(v255, cg_alpha_lo_sse2(s));
+		__m128i ahi = _mm_sub_epi16(v255, cg_alpha_hi_sse2(s));
+		if(alpha != 255)
+		{
+			alo = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(alo, va), 8), vcia);
+			ahi = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(ahi, va), 8), vcia);
+		}
+		_mm_storeu_si128((__m128i *)(dst + i), cg_byte_mul_sse2(d, alo, ahi));
+	}
+	__cg_comp_destination_out(dst + i, len - i, src + i, alpha);
+}
+
+CG_TARGET_SSE2 static inline __m128i cg_comp_mask_sse2(const uint8_t * mask)
+{
+	uint32_t m;
+	memcpy(&m, mask, sizeof(uint32_t));
+	__m128i v = _mm_cvtsi32_si128((int)m);
+	v = _mm_unpacklo_epi8(v, v);
+	return _mm_unpacklo_epi16(v, v);
+}
+
+CG_TARGET_SSE2 static void cg_comp_solid_source_mask_sse2(uint32_t * dst, int len, uint32_t color, const uint8_t * mask)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i v255 = _mm_set1_epi16(0xff);
+	__m128i c = _mm_set1_epi32((int)color);
+	int i = 0;
+	for(; i + 4 <= len; i += 4)
+	{
+		__m128i m = cg_comp_mask_sse2(mask + i);
+		__m128i full = _mm_cmpeq_epi8(m, _mm_set1_epi8(-1));
+		__m128i mlo = _mm_unpacklo_epi8(m, zero);
+		__m128i mhi = _mm_unpackhi_epi8(m, zero);
+		__m128i s = cg_byte_mul_sse2(c, mlo, mhi);
+		s = _mm_or_si128(_mm_and_si128(full, c), _mm_andnot_si128(full, s));
+		__m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_add_epi32(s, cg_byte_mul_sse2(d, _mm_sub_epi16(v255, mlo), _mm_sub_epi16(v255, mhi))));
+	}
+	__cg_comp_solid_source_mask(dst + i, len - i, color, mask + i);
+}
+
+CG_TARGET_SSE2 static void cg_comp_solid_source_over_mask_sse2(uint32_t * dst, int len, uint32_t color, const uint8_t * mask)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i v255 = _mm_set1_epi16(0xff);
+	__m128i c = _mm_set1_epi32((int)color);
+	int i = 0;
+	for(; i + 4 <= len; i += 4)
+	{
+		__m128i m = cg_comp_mask_sse2(mask + i);
+		__m128i full = _mm_cmpeq_epi8(m, _mm_set1_epi8(-1));
+		__m128i s = cg_byte_mul_sse2(c, _mm_unpacklo_epi8(m, zero), _mm_unpackhi_epi8(m, zero));
+		s = _mm_or_si128(_mm_and_si128(full, c), _mm_andnot_si128(full, s));
+		__m128i d = _mm_loadu_si128((__m128i *)(dst + i));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_add_epi32(s, cg_byte_mul_sse2(d, _mm_sub_epi16(v255, cg_alpha_lo_sse2(s)), _mm_sub_epi16(v255, cg_alpha_hi_sse2(s)))));
+	}
+	__cg_comp_solid_source_over_mask(dst + i, len - i, color, mask + i);
+}
+
+CG_TARGET_SSE2 static inline __m128i cg_div255_sse2(__m128i t)
+{
+	return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), _mm_set1_epi16(0x80)), 8);
+}
+
+CG_TARGET_SSE2 static inline __m128i cg_mul255_sse2(__m128i x, __m128i y)
+{
+	return cg_div255_sse2(_mm_mullo_epi16(x, y));
+}
+
+CG_TARGET_SSE2 static inline __m128i cg_blend_half_sse2(__m128i s, __m128i d, enum cg_operator_t op)
+{
+	__m128i v255 = _mm_set1_epi16(0xff);
+	__m128i sa = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m128i da = _mm_shufflehi_epi16(_mm_shufflelo_epi16(d, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m128i sia = _mm_sub_epi16(v255, sa);
+	__m128i dia = _mm_sub_epi16(v255, da);
+	__m128i r;
+	int rest = 1;
+	switch(op)
+	{
+	case CG_OPERATOR_SRC_IN:
+		return cg_mul255_sse2(s, da);
+	case CG_OPERATOR_SRC_OUT:
+		return cg_mul255_sse2(s, dia);
+	case CG_OPERATOR_SRC_ATOP:
+		return cg_div255_sse2(_mm_add_epi16(_mm_mullo_epi16(s, da), _mm_mullo_epi16(d, sia)));
+	case CG_OPERATOR_DST_OVER:
+		return _mm_add_epi16(d, cg_mul255_sse2(s, dia));
+	case CG_OPERATOR_DST_ATOP:
+		return cg_div255_sse2(_mm_add_epi16(_mm_mullo_epi16(d, sa), _mm_mullo_epi16(s, dia)));
+	case CG_OPERATOR_XOR:
+		return cg_div255_sse2(_mm_add_epi16(_mm_mullo_epi16(s, dia), _mm_mullo_epi16(d, sia)));
+	case CG_OPERATOR_MULTIPLY:
+		r = cg_mul255_sse2(s, d);
+		break;
+	case CG_OPERATOR_SCREEN:
+		r = _mm_sub_epi16(_mm_add_epi16(s, d), cg_mul255_sse2(s, d));
+		rest = 0;
+		break;
+	case CG_OPERATOR_OVERLAY:
+	case CG_OPERATOR_HARD_LIGHT:
+		{
+			__m128i mask = (op == CG_OPERATOR_OVERLAY) ? _mm_cmpgt_epi16(_mm_add_epi16(d, d), da) : _mm_cmpgt_epi16(_mm_add_epi16(s, s), sa);
+			__m128i lo = cg_mul255_sse2(s, d);
+			__m128i hi = cg_mul255_sse2(_mm_sub_epi16(da, d), _mm_sub_epi16(sa, s));
+			lo = _mm_add_epi16(lo, lo);
+			hi = _mm_sub_epi16(cg_mul255_sse2(sa, da), _mm_add_epi16(hi, hi));
+			r = _mm_or_si128(_mm_andnot_si128(mask, lo), _mm_and_si128(mask, hi));
+		}
+		break;
+	case CG_OPERATOR_DARKEN:
+		r = _mm_min_epi16(cg_mul255_sse2(s, da), cg_mul255_sse2(d, sa));
+		break;
+	case CG_OPERATOR_LIGHTEN:
+		r = _mm_max_epi16(cg_mul255_sse2(s, da), cg_mul255_sse2(d, sa));
+		break;
+	case CG_OPERATOR_DIFFERENCE:
+		r = _mm_min_epi16(cg_mul255_sse2(s, da), cg_mul255_sse2(d, sa));
+		r = _mm_sub_epi16(_mm_add_epi16(s, d), _mm_add_epi16(r, r));
+		rest = 0;
+		break;
+	case CG_OPERATOR_EXCLUSION:
+		r = cg_mul255_sse2(s, d);
+		r = _mm_sub_epi16(_mm_add_epi16(s, d), _mm_add_epi16(r, r));
+		rest = 0;
+		break;
+	default:
+		return s;
+	}
+	if(rest)
+		r = _mm_add_epi16(r, _mm_add_epi16(cg_mul255_sse2(s, dia), cg_mul255_sse2(d, sia)));
+	r = _mm_min_epi16(_mm_max_epi16(r, _mm_setzero_si128()), v255);
+	__m128i mask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+	__m128i a = _mm_sub_epi16(_mm_add_epi16(sa, da), cg_mul255_sse2(sa, da));
+	return _mm_or_si128(_mm_andnot_si128(mask, r), _mm_and_si128(mask, a));
+}
+
+CG_TARGET_SSE2 static inline __m128i cg_blend_pixel_sse2(__m128i s, __m128i d, enum cg_operator_t op)
+{
+	__m128i zero = _mm_setzero_si128();
+	if(op == CG_OPERATOR_CLEAR)
+		return zero;
+	if(op == CG_OPERATOR_ADD)
+		return _mm_adds_epu8(s, d);
+	__m128i lo = cg_blend_half_sse2(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), op);
+	__m128i hi = cg_blend_half_sse2(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), op);
+	return _mm_packus_epi16(lo, hi);
+}
+
+#define CG_COMP_DEFINE_SSE2(name, op) \
+CG_TARGET_SSE2 static void cg_comp_solid_##name##_sse2(uint32_t * dst, int len, uint32_t color, uint32_t alpha) \
+{ \
+	__m128i s = _mm_set1_epi32((int)color); \
+	__m128i va = _mm_set1_epi16((short)alpha); \
+	__m128i via = _mm_set1_epi16((short)(255 - alpha)); \
+	int i = 0; \
+	for(; i + 4 <= len; i += 4) \
+	{ \
+		__m128i d = _mm_loadu_si128((__m128i *)(dst + i)); \
+		__m128i r = cg_blend_pixel_sse2(s, d, op); \
+		if(alpha != 255) \
+			r = cg_interpolate_sse2(r, va, d, via); \
+		_mm_storeu_si128((__m128i *)(dst + i), r); \
+	} \
+	__cg_comp_solid_##name(dst + i, len - i, color, alpha); \
+} \
+CG_TARGET_SSE2 static void cg_comp_##name##_sse2(uint32_t * dst, int len, uint32_t * src, uint32_t alpha) \
+{ \
+	__m128i va = _mm_set1_epi16((short)alpha); \
+	__m128i via = _mm_set1_epi16((short)(255 - alpha)); \
+	int i = 0; \
+	for(; i + 4 <= len; i += 4) \
+	{ \
+		__m128i d = _mm_loadu_si128((__m128i *)(dst + i)); \
+		__m128i r = cg_blend_pixel_sse2(_mm_loadu_si128((__m128i *)(src + i)), d, op); \
+		if(alpha != 255) \
+			r = cg_interpolate_sse2(r, va, d, via); \
+		_mm_storeu_si128((__m128i *)(dst + i), r); \
+	} \
+	__cg_comp_##name(dst + i, len - i, src + i, alpha); \
+}
+
+CG_COMP_DEFINE_SSE2(clear, CG_OPERATOR_CLEAR)
+CG_COMP_DEFINE_SSE2(source_in, CG_OPERATOR_SRC_IN)
+CG_COMP_DEFINE_SSE2(source_out, CG_OPERATOR_SRC_OUT)
+CG_COMP_DEFINE_SSE2(source_atop, CG_OPERATOR_SRC_ATOP)
+CG_COMP_DEFINE_SSE2(destination_over, CG_OPERATOR_DST_OVER)
+CG_COMP_DEFINE_SSE2(destination_atop, CG_OPERATOR_DST_ATOP)
+CG_COMP_DEFINE_SSE2(xor, CG_OPERATOR_XOR)
+CG_COMP_DEFINE_SSE2(add, CG_OPERATOR_ADD)
+CG_COMP_DEFINE_SSE2(multiply, CG_OPERATOR_MULTIPLY)
+CG_COMP_DEFINE_SSE2(screen, CG_OPERATOR_SCREEN)
+CG_COMP_DEFINE_SSE2(overlay, CG_OPERATOR_OVERLAY)
+CG_COMP_DEFINE_SSE2(darken, CG_OPERATOR_DARKEN)
+CG_COMP_DEFINE_SSE2(lighten, CG_OPERATOR_LIGHTEN)
+CG_COMP_DEFINE_SSE2(hard_light, CG_OPERATOR_HARD_LIGHT)
+CG_COMP_DEFINE_SSE2(difference, CG_OPERATOR_DIFFERENCE)
+CG_COMP_DEFINE_SSE2(exclusion, CG_OPERATOR_EXCLUSION)
+
+CG_TARGET_AVX2 static inline __m256i cg_byte_mul_avx2(__m256i x, __m256i alo, __m256i ahi)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(x, zero), alo), 8);
+	__m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(x, zero), ahi), 8);
+	return _mm256_packus_epi16(lo, hi);
+}
+
+CG_TARGET_AVX2 static inline __m256i cg_alpha_lo_avx2(__m256i x)
+{
+	__m256i t = _mm256_unpacklo_epi8(x, _mm256_setzero_si256());
+	return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(t, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+CG_TARGET_AVX2 static inline __m256i cg_alpha_hi_avx2(__m256i x)
+{
+	__m256i t = _mm256_unpackhi_epi8(x, _mm256_setzero_si256());
+	return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(t, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+CG_TARGET_AVX2 static inline __m256i cg_interpolate_avx2(__m256i x, __m256i a, __m256i y, __m256i b)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i half = _mm256_set1_epi16(0x80);
+	__m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(x, zero), a), _mm256_mullo_epi16(_mm256_unpacklo_epi8(y, zero), b));
+	__m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(x, zero), a), _mm256_mullo_epi16(_mm256_unpackhi_epi8(y, zero), b));
+	lo = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(lo, _mm256_srli_epi16(lo, 8)), half), 8);
+	hi = _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(hi, _mm256_srli_epi16(hi, 8)), half), 8);
+	return _mm256_packus_epi16(lo, hi);
+}
+
+CG_TARGET_AVX2 static inline void cg_memfill32_avx2(uint32_t * dst, uint32_t val, int len)
+{
+	__m256i v = _mm256_set1_epi32((int)val);
+	int i = 0;
+	for(; i + 32 <= len; i += 32)
+	{
+		_mm256_storeu_si256((__m256i *)(dst + i), v);
+		_mm256_storeu_si256((__m256i *)(dst + i + 8), v);
+		_mm256_storeu_si256((__m256i *)(dst + i + 16), v);
+		_mm256_storeu_si256((__m256i *)(dst + i + 24), v);
+	}
+	for(; i + 8 <= len; i += 8)
+		_mm256_storeu_si256((__m256i *)(dst + i), v);
+	for(; i < len; i++)
+		dst[i] = val;
+}
+
+CG_TARGET_AVX2 static inline void cg_comp_add_mul_avx2(uint32_t * dst, int len, uint32_t color, uint32_t a)
+{
+	__m256i c = _mm256_set1_epi32((int)color);
+	__m256i va = _mm256_set1_epi16((short)a);
+	int i = 0;
+	for(; i + 8 <= len; i += 8)
+	{
+		__m256i d = _mm256_loadu_si256((__m256i *)(dst + i));
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_add_epi32(c, cg_byte_mul_avx2(d, va, va)));
+	}
+	for(; i < len; i++)
+		dst[i] = color + CG_BYTE_MUL(dst[i], a);
+}
+
+CG_TARGET_AVX2 static inline void cg_comp_mul_avx2(uint32_t * dst, int len, uint32_t a)
+{
+	__m256i va = _mm256_set1_epi16((short)a);
+	int i = 0;
+	for(; i + 8 <= len; i += 8)
+	{
+		__m256i d = _mm256_loadu_si256((__m256i *)(dst + i));
+		_mm256_storeu_si256((__m256i *)(dst + i), cg_byte_mul_avx2(d, va, va));
+	}
+	for(; i < len; i++)
+		dst[i] = CG_BYTE_MUL(dst[i], a);
+}
+
+CG_TARGET_AVX2 static void cg_comp_solid_source_avx2(uint32_t * dst, int len, uint32_t color, uint32_t alpha)
+{
+	if(alpha == 255)
+		cg_memfill32_avx2(dst, color, len);
+	else
+		cg_comp_add_mul_avx2(dst, len, CG_BYTE_MUL(color, alpha), 255 - alpha);
+}
+
+CG_TARGET_AVX2 static void cg_comp_solid_source_over_avx2(uint32_t * dst, int len, uint32_t color, uint32_t alpha)
+{
+	if((alpha & CG_ALPHA(color)) == 255)
+	{
+		cg_memfill32_avx2(dst, color, len);
+	}
+	else
+	{
+		if(alpha != 255)
+			color = CG_BYTE_MUL(color, alpha);
+		cg_comp_add_mul_avx2(dst, len, color, 255 - CG_ALPHA(color));
+	}
+}
+
+CG_TARGET_AVX2 static void cg_comp_solid_destination_in_avx2(uint32_t * dst, int len, uint32_t color, uint32_t alpha)
+{
+	uint32_t a = CG_ALPHA(color);
+	if(alpha != 255)
+		a = CG_BYTE_MUL(a, alpha) + 255 - alpha;
+	cg_comp_mul_avx2(dst, len, a);
+}
 
-static void __cg_comp_solid_destination_out(uint32_t * dst, int len, uint32_t color, uint32_t alpha)
+CG_TARGET_AVX2 static void cg_comp_solid_destination_out_avx2(uint32_t * dst, int len, uint32_t color, uint32_t alpha)
 {
 	uint32_t a = CG_ALPHA(~color);
 	if(alpha != 255)
 		a = CG_BYTE_MUL(a, alpha) + 255 - alpha;
-	for(int i = 0; i < len; i++)
-		dst[i] = CG_BYTE_MUL(dst[i], a);
+	cg_comp_mul_avx2(dst, len, a);
 }
-extern __typeof(__cg_comp_solid_destination_out) cg_comp_solid_destination_out __attribute__((weak, alias("__cg_comp_solid_destination_out")));
 
-static void __cg_comp_source(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+CG_TARGET_AVX2 static void cg_comp_source_avx2(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
 {
 	if(alpha == 255)
 	{
@@ -1711,108 +3968,783 @@ static void __cg_comp_source(uint32_t * dst, int len, uint32_t * src, uint32_t a
 	}
 	else
 	{
-		uint32_t ialpha = 255 - alpha;
-		for(int i = 0; i < len; i++)
-			dst[i] = interpolate_pixel(src[i], alpha, dst[i], ialpha);
+		__m256i va = _mm256_set1_epi16((short)alpha);
+		__m256i via = _mm256_set1_epi16((short)(255 - alpha));
+		int i = 0;
+		for(; i + 8 <= len; i += 8)
+		{
+			__m256i s = _mm256_loadu_si256((__m256i *)(src + i));
+			__m256i d = _mm256_loadu_si256((__m256i *)(dst + i));
+			_mm256_storeu_si256((__m256i *)(dst + i), cg_interpolate_avx2(s, va, d, via));
+		}
+		_mm256_zeroupper();
+		__cg_comp_source(dst + i, len - i, src + i, alpha);
 	}
 }
-extern __typeof(__cg_comp_source) cg_comp_source __attribute__((weak, alias("__cg_comp_source")));
 
-static void __cg_comp_source_over(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+CG_TARGET_AVX2 static void cg_comp_source_over_avx2(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
 {
-	uint32_t s, sia;
+	__m256i zero = _mm256_setzero_si256();
+	__m256i v255 = _mm256_set1_epi16(0xff);
+	int i = 0;
 	if(alpha == 255)
 	{
-		for(int i = 0; i < len; i++)
+		for(; i + 8 <= len; i += 8)
 		{
-			s = src[i];
-			if(s >= 0xff000000)
-				dst[i] = s;
-			else if(s != 0)
+			__m256i s = _mm256_loadu_si256((__m256i *)(src + i));
+			__m256i opaque = _mm256_cmpeq_epi32(_mm256_srli_epi32(s, 24), _mm256_set1_epi32(0xff));
+			if(_mm256_movemask_epi8(opaque) == -1)
 			{
-				sia = CG_ALPHA(~s);
-				dst[i] = s + CG_BYTE_MUL(dst[i], sia);
+				_mm256_storeu_si256((__m256i *)(dst + i), s);
+				continue;
 			}
+			__m256i transparent = _mm256_cmpeq_epi32(s, zero);
+			if(_mm256_movemask_epi8(transparent) == -1)
+				continue;
+			__m256i d = _mm256_loadu_si256((__m256i *)(dst + i));
+			__m256i r = _mm256_add_epi32(s, cg_byte_mul_avx2(d, _mm256_sub_epi16(v255, cg_alpha_lo_avx2(s)), _mm256_sub_epi16(v255, cg_alpha_hi_avx2(s))));
+			_mm256_storeu_si256((__m256i *)(dst + i), _mm256_blendv_epi8(r, d, transparent));
 		}
 	}
 	else
 	{
-		for(int i = 0; i < len; i++)
+		__m256i va = _mm256_set1_epi16((short)alpha);
+		for(; i + 8 <= len; i += 8)
 		{
-			s = CG_BYTE_MUL(src[i], alpha);
-			sia = CG_ALPHA(~s);
-			dst[i] = s + CG_BYTE_MUL(dst[i], sia);
+			__m256i s = cg_byte_mul_avx2(_mm256_loadu_si256((__m256i *)(src + i)), va, va);
+			__m256i d = _mm256_loadu_si256((__m256i *)(dst + i));
+			__m256i r = _mm256_add_epi32(s, cg_byte_mul_avx2(d, _mm256_sub_epi16(v255, cg_alpha_lo_avx2(s)), _mm256_sub_epi16(v255, cg_alpha_hi_avx2(s))));
+			_mm256_storeu_si256((__m256i *)(dst + i), r);
 		}
 	}
+	_mm256_zeroupper();
+	__cg_comp_source_over(dst + i, len - i, src + i, alpha);
 }
-extern __typeof(__cg_comp_source_over) cg_comp_source_over __attribute__((weak, alias("__cg_comp_source_over")));
 
-static void __cg_comp_destination_in(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+CG_TARGET_AVX2 static void cg_comp_destination_in_avx2(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
 {
-	if(alpha == 255)
+	__m256i va = _mm256_set1_epi16((short)alpha);
+	__m256i vcia = _mm256_set1_epi16((short)(255 - alpha));
+	int i = 0;
+	for(; i + 8 <= len; i += 8)
 	{
-		for(int i = 0; i < len; i++)
-			dst[i] = CG_BYTE_MUL(dst[i], CG_ALPHA(src[i]));
+		__m256i s = _mm256_loadu_si256((__m256i *)(src + i));
+		__m256i d = _mm256_loadu_si256((__m256i *)(dst + i));
+		__m256i alo = cg_alpha_lo_avx2(s);
+		__m256i ahi = cg_alpha_hi_avx2(s);
+		if(alpha != 255)
+		{
+			alo = _mm256_add_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(alo, va), 8), vcia);
+			ahi = _mm256_add_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(ahi, va), 8), vcia);
+		}
+		_mm256_storeu_si256((__m256i *)(dst + i), cg_byte_mul_avx2(d, alo, ahi));
 	}
-	else
+	_mm256_zeroupper();
+	__cg_comp_destination_in(dst + i, len - i, src + i, alpha);
+}
+
+CG_TARGET_AVX2 static void cg_comp_destination_out_avx2(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+{
+	__m256i va = _mm256_set1_epi16((short)alpha);
+	__m256i vcia = _mm256_set1_epi16((short)(255 - alpha));
+	__m256i v255 = _mm256_set1_epi16(0xff);
+	int i = 0;
+	for(; i + 8 <= len; i += 8)
 	{
-		uint32_t cia = 255 - alpha;
-		uint32_t a;
-		for(int i = 0; i < len; i++)
+		__m256i s = _mm256_loadu_si256((__m256i *)(src + i));
+		__m256i d = _mm256_loadu_si256((__m256i *)(dst + i));
+		__m256i alo = _mm256_sub_epi16(v255, cg_alpha_lo_avx2(s));
+		__m256i ahi = _mm256_sub_epi16(v255, cg_alpha_hi_avx2(s));
+		if(alpha != 255)
 		{
-			a = CG_BYTE_MUL(CG_ALPHA(src[i]), alpha) + cia;
-			dst[i] = CG_BYTE_MUL(dst[i], a);
+			alo = _mm256_add_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(alo, va), 8), vcia);
+			ahi = _mm256_add_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(ahi, va), 8), vcia);
 		}
+		_mm256_storeu_si256((__m256i *)(dst + i), cg_byte_mul_avx2(d, alo, ahi));
 	}
+	_mm256_zeroupper();
+	__cg_comp_destination_out(dst + i, len - i, src + i, alpha);
 }
-extern __typeof(__cg_comp_destination_in) cg_comp_destination_in __attribute__((weak, alias("__cg_comp_destination_in")));
 
-static void __cg_comp_destination_out(uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+CG_TARGET_AVX2 static inline __m256i cg_comp_mask_avx2(const uint8_t * mask)
 {
-	if(alpha == 255)
+	__m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)mask));
+	return _mm256_mullo_epi32(v, _mm256_set1_epi32(0x01010101));
+}
+
+CG_TARGET_AVX2 static void cg_comp_solid_source_mask_avx2(uint32_t * dst, int len, uint32_t color, const uint8_t * mask)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i v255 = _mm256_set1_epi16(0xff);
+	__m256i c = _mm256_set1_epi32((int)color);
+	int i = 0;
+	for(; i + 8 <= len; i += 8)
 	{
-		for(int i = 0; i < len; i++)
-			dst[i] = CG_BYTE_MUL(dst[i], CG_ALPHA(~src[i]));
+		__m256i m = cg_comp_mask_avx2(mask + i);
+		__m256i mlo = _mm256_unpacklo_epi8(m, zero);
+		__m256i mhi = _mm256_unpackhi_epi8(m, zero);
+		__m256i s = _mm256_blendv_epi8(cg_byte_mul_avx2(c, mlo, mhi), c, _mm256_cmpeq_epi8(m, _mm256_set1_epi8(-1)));
+		__m256i d = _mm256_loadu_si256((__m256i *)(dst + i));
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_add_epi32(s, cg_byte_mul_avx2(d, _mm256_sub_epi16(v255, mlo), _mm256_sub_epi16(v255, mhi))));
 	}
-	else
+	_mm256_zeroupper();
+	__cg_comp_solid_source_mask(dst + i, len - i, color, mask + i);
+}
+
+CG_TARGET_AVX2 static void cg_comp_solid_source_over_mask_avx2(uint32_t * dst, int len, uint32_t color, const uint8_t * mask)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i v255 = _mm256_set1_epi16(0xff);
+	__m256i c = _mm256_set1_epi32((int)color);
+	int i = 0;
+	for(; i + 8 <= len; i += 8)
 	{
-		uint32_t cia = 255 - alpha;
-		uint32_t sia;
-		for(int i = 0; i < len; i++)
+		__m256i m = cg_comp_mask_avx2(mask + i);
+		__m256i s = cg_byte_mul_avx2(c, _mm256_unpacklo_epi8(m, zero), _mm256_unpackhi_epi8(m, zero));
+		s = _mm256_blendv_epi8(s, c, _mm256_cmpeq_epi8(m, _mm256_set1_epi8(-1)));
+		__m256i d = _mm256_loadu_si256((__m256i *)(dst + i));
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_add_epi32(s, cg_byte_mul_avx2(d, _mm256_sub_epi16(v255, cg_alpha_lo_avx2(s)), _mm256_sub_epi16(v255, cg_alpha_hi_avx2(s)))));
+	}
+	_mm256_zeroupper();
+	__cg_comp_solid_source_over_mask(dst + i, len - i, color, mask + i);
+}
+
+CG_TARGET_AVX2 static inline __m256i cg_div255_avx2(__m256i t)
+{
+	return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), _mm256_set1_epi16(0x80)), 8);
+}
+
+CG_TARGET_AVX2 static inline __m256i cg_mul255_avx2(__m256i x, __m256i y)
+{
+	return cg_div255_avx2(_mm256_mullo_epi16(x, y));
+}
+
+CG_TARGET_AVX2 static inline __m256i cg_blend_half_avx2(__m256i s, __m256i d, enum cg_operator_t op)
+{
+	__m256i v255 = _mm256_set1_epi16(0xff);
+	__m256i sa = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m256i da = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(d, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m256i sia = _mm256_sub_epi16(v255, sa);
+	__m256i dia = _mm256_sub_epi16(v255, da);
+	__m256i r;
+	int rest = 1;
+	switch(op)
+	{
+	case CG_OPERATOR_SRC_IN:
+		return cg_mul255_avx2(s, da);
+	case CG_OPERATOR_SRC_OUT:
+		return cg_mul255_avx2(s, dia);
+	case CG_OPERATOR_SRC_ATOP:
+		return cg_div255_avx2(_mm256_add_epi16(_mm256_mullo_epi16(s, da), _mm256_mullo_epi16(d, sia)));
+	case CG_OPERATOR_DST_OVER:
+		return _mm256_add_epi16(d, cg_mul255_avx2(s, dia));
+	case CG_OPERATOR_DST_ATOP:
+		return cg_div255_avx2(_mm256_add_epi16(_mm256_mullo_epi16(d, sa), _mm256_mullo_epi16(s, dia)));
+	case CG_OPERATOR_XOR:
+		return cg_div255_avx2(_mm256_add_epi16(_mm256_mullo_epi16(s, dia), _mm256_mullo_epi16(d, sia)));
+	case CG_OPERATOR_MULTIPLY:
+		r = cg_mul255_avx2(s, d);
+		break;
+	case CG_OPERATOR_SCREEN:
+		r = _mm256_sub_epi16(_mm256_add_epi16(s, d), cg_mul255_avx2(s, d));
+		rest = 0;
+		break;
+	case CG_OPERATOR_OVERLAY:
+	case CG_OPERATOR_HARD_LIGHT:
 		{
-			sia = CG_BYTE_MUL(CG_ALPHA(~src[i]), alpha) + cia;
-			dst[i] = CG_BYTE_MUL(dst[i], sia);
+			__m256i mask = (op == CG_OPERATOR_OVERLAY) ? _mm256_cmpgt_epi16(_mm256_add_epi16(d, d), da) : _mm256_cmpgt_epi16(_mm256_add_epi16(s, s), sa);
+			__m256i lo = cg_mul255_avx2(s, d);
+			__m256i hi = cg_mul255_avx2(_mm256_sub_epi16(da, d), _mm256_sub_epi16(sa, s));
+			lo = _mm256_add_epi16(lo, lo);
+			hi = _mm256_sub_epi16(cg_mul255_avx2(sa, da), _mm256_add_epi16(hi, hi));
+			r = _mm256_blendv_epi8(lo, hi, mask);
+		}
+		break;
+	case CG_OPERATOR_DARKEN:
+		r = _mm256_min_epi16(cg_mul255_avx2(s, da), cg_mul255_avx2(d, sa));
+		break;
+	case CG_OPERATOR_LIGHTEN:
+		r = _mm256_max_epi16(cg_mul255_avx2(s, da), cg_mul255_avx2(d, sa));
+		break;
+	case CG_OPERATOR_DIFFERENCE:
+		r = _mm256_min_epi16(cg_mul255_avx2(s, da), cg_mul255_avx2(d, sa));
+		r = _mm256_sub_epi16(_mm256_add_epi16(s, d), _mm256_add_epi16(r, r));
+		rest = 0;
+		break;
+	case CG_OPERATOR_EXCLUSION:
+		r = cg_mul255_avx2(s, d);
+		r = _mm256_sub_epi16(_mm256_add_epi16(s, d), _mm256_add_epi16(r, r));
+		rest = 0;
+		break;
+	default:
+		return s;
+	}
+	if(rest)
+		r = _mm256_add_epi16(r, _mm256_add_epi16(cg_mul255_avx2(s, dia), cg_mul255_avx2(d, sia)));
+	r = _mm256_min_epi16(_mm256_max_epi16(r, _mm256_setzero_si256()), v255);
+	return _mm256_blend_epi16(r, _mm256_sub_epi16(_mm256_add_epi16(sa, da), cg_mul255_avx2(sa, da)), 0x88);
+}
+
+CG_TARGET_AVX2 static inline __m256i cg_blend_pixel_avx2(__m256i s, __m256i d, enum cg_operator_t op)
+{
+	__m256i zero = _mm256_setzero_si256();
+	if(op == CG_OPERATOR_CLEAR)
+		return zero;
+	if(op == CG_OPERATOR_ADD)
+		return _mm256_adds_epu8(s, d);
+	__m256i lo = cg_blend_half_avx2(_mm256_unpacklo_epi8(s, zero), _mm256_unpacklo_epi8(d, zero), op);
+	__m256i hi = cg_blend_half_avx2(_mm256_unpackhi_epi8(s, zero), _mm256_unpackhi_epi8(d, zero), op);
+	return _mm256_packus_epi16(lo, hi);
+}
+
+#define CG_COMP_DEFINE_AVX2(name, op) \
+CG_TARGET_AVX2 static void cg_comp_solid_##name##_avx2(uint32_t * dst, int len, uint32_t color, uint32_t alpha) \
+{ \
+	__m256i s = _mm256_set1_epi32((int)color); \
+	__m256i va = _mm256_set1_epi16((short)alpha); \
+	__m256i via = _mm256_set1_epi16((short)(255 - alpha)); \
+	int i = 0; \
+	for(; i + 8 <= len; i += 8) \
+	{ \
+		__m256i d = _mm256_loadu_si256((__m256i *)(dst + i)); \
+		__m256i r = cg_blend_pixel_avx2(s, d, op); \
+		if(alpha != 255) \
+			r = cg_interpolate_avx2(r, va, d, via); \
+		_mm256_storeu_si256((__m256i *)(dst + i), r); \
+	} \
+	_mm256_zeroupper(); \
+	__cg_comp_solid_##name(dst + i, len - i, color, alpha); \
+} \
+CG_TARGET_AVX2 static void cg_comp_##name##_avx2(uint32_t * dst, int len, uint32_t * src, uint32_t alpha) \
+{ \
+	__m256i va = _mm256_set1_epi16((short)alpha); \
+	__m256i via = _mm256_set1_epi16((short)(255 - alpha)); \
+	int i = 0; \
+	for(; i + 8 <= len; i += 8) \
+	{ \
+		__m256i d = _mm256_loadu_si256((__m256i *)(dst + i)); \
+		__m256i r = cg_blend_pixel_avx2(_mm256_loadu_si256((__m256i *)(src + i)), d, op); \
+		if(alpha != 255) \
+			r = cg_interpolate_avx2(r, va, d, via); \
+		_mm256_storeu_si256((__m256i *)(dst + i), r); \
+	} \
+	_mm256_zeroupper(); \
+	__cg_comp_##name(dst + i, len - i, src + i, alpha); \
+}
+
+CG_COMP_DEFINE_AVX2(clear, CG_OPERATOR_CLEAR)
+CG_COMP_DEFINE_AVX2(source_in, CG_OPERATOR_SRC_IN)
+CG_COMP_DEFINE_AVX2(source_out, CG_OPERATOR_SRC_OUT)
+CG_COMP_DEFINE_AVX2(source_atop, CG_OPERATOR_SRC_ATOP)
+CG_COMP_DEFINE_AVX2(destination_over, CG_OPERATOR_DST_OVER)
+CG_COMP_DEFINE_AVX2(destination_atop, CG_OPERATOR_DST_ATOP)
+CG_COMP_DEFINE_AVX2(xor, CG_OPERATOR_XOR)
+CG_COMP_DEFINE_AVX2(add, CG_OPERATOR_ADD)
+CG_COMP_DEFINE_AVX2(multiply, CG_OPERATOR_MULTIPLY)
+CG_COMP_DEFINE_AVX2(screen, CG_OPERATOR_SCREEN)
+CG_COMP_DEFINE_AVX2(overlay, CG_OPERATOR_OVERLAY)
+CG_COMP_DEFINE_AVX2(darken, CG_OPERATOR_DARKEN)
+CG_COMP_DEFINE_AVX2(lighten, CG_OPERATOR_LIGHTEN)
+CG_COMP_DEFINE_AVX2(hard_light, CG_OPERATOR_HARD_LIGHT)
+CG_COMP_DEFINE_AVX2(difference, CG_OPERATOR_DIFFERENCE)
+CG_COMP_DEFINE_AVX2(exclusion, CG_OPERATOR_EXCLUSION)
+#endif
+
+static uint32_t cg_unpremultiply_table[256];
+
+static void cg_unpremultiply_init(void)
+{
+	cg_unpremultiply_table[0] = 0;
+	for(uint32_t a = 1; a < 256; a++)
+		cg_unpremultiply_table[a] = ((255 << 16) + a / 2) / a;
+}
+
+static inline uint32_t cg_unpremultiply(uint32_t c, uint32_t inv)
+{
+	c = (c * inv + 0x8000) >> 16;
+	return (c > 255) ? 255 : c;
+}
+
+static void __cg_convert_from_rgba(uint32_t * dst, const uint32_t * src, int len)
+{
+	for(int i = 0; i < len; i++)
+	{
+		uint32_t p = src[i];
+		uint32_t a = p >> 24;
+		if(a == 255)
+			dst[i] = (p & 0xff00ff00) | ((p >> 16) & 0xff) | ((p & 0xff) << 16);
+		else if(a == 0)
+			dst[i] = 0;
+		else
+		{
+			uint32_t r = CG_DIV255((p & 0xff) * a);
+			uint32_t g = CG_DIV255(((p >> 8) & 0xff) * a);
+			uint32_t b = CG_DIV255(((p >> 16) & 0xff) * a);
+			dst[i] = (a << 24) | (r << 16) | (g << 8) | b;
+		}
+	}
+}
+
+static void __cg_convert_to_rgba(uint32_t * dst, const uint32_t * src, int len)
+{
+	for(int i = 0; i < len; i++)
+	{
+		uint32_t p = src[i];
+		uint32_t a = p >> 24;
+		if(a == 255)
+			dst[i] = (p & 0xff00ff00) | ((p >> 16) & 0xff) | ((p & 0xff) << 16);
+		else if(a == 0)
+			dst[i] = 0;
+		else
+		{
+			uint32_t inv = cg_unpremultiply_table[a];
+			uint32_t r = cg_unpremultiply((p >> 16) & 0xff, inv);
+			uint32_t g = cg_unpremultiply((p >> 8) & 0xff, inv);
+			uint32_t b = cg_unpremultiply(p & 0xff, inv);
+			dst[i] = (a << 24) | (b << 16) | (g << 8) | r;
 		}
 	}
 }
-extern __typeof(__cg_comp_destination_out) cg_comp_destination_out __attribute__((weak, alias("__cg_comp_destination_out")));
+
+#ifdef CG_SIMD_X86
+CG_TARGET_SSE2 static void cg_convert_from_rgba_sse2(uint32_t * dst, const uint32_t * src, int len)
+{
+	__m128i agmask = _mm_set1_epi32(0xff00ff00);
+	__m128i rbmask = _mm_set1_epi32(0x00ff00ff);
+	__m128i opaque = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+	int i = 0;
+	for(; i + 4 <= len; i += 4)
+	{
+		__m128i p = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i rb = _mm_and_si128(p, rbmask);
+		rb = _mm_shufflehi_epi16(_mm_shufflelo_epi16(rb, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+		p = _mm_or_si128(_mm_and_si128(p, agmask), rb);
+		__m128i lo = cg_mul255_sse2(_mm_unpacklo_epi8(p, _mm_setzero_si128()), _mm_or_si128(cg_alpha_lo_sse2(p), opaque));
+		__m128i hi = cg_mul255_sse2(_mm_unpackhi_epi8(p, _mm_setzero_si128()), _mm_or_si128(cg_alpha_hi_sse2(p), opaque));
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+	__cg_convert_from_rgba(dst + i, src + i, len - i);
+}
+
+CG_TARGET_AVX2 static void cg_convert_from_rgba_avx2(uint32_t * dst, const uint32_t * src, int len)
+{
+	__m256i swizzle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+	__m256i opaque = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0);
+	int i = 0;
+	for(; i + 8 <= len; i += 8)
+	{
+		__m256i p = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(src + i)), swizzle);
+		__m256i lo = cg_mul255_avx2(_mm256_unpacklo_epi8(p, _mm256_setzero_si256()), _mm256_or_si256(cg_alpha_lo_avx2(p), opaque));
+		__m256i hi = cg_mul255_avx2(_mm256_unpackhi_epi8(p, _mm256_setzero_si256()), _mm256_or_si256(cg_alpha_hi_avx2(p), opaque));
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_packus_epi16(lo, hi));
+	}
+	_mm256_zeroupper();
+	__cg_convert_from_rgba(dst + i, src + i, len - i);
+}
+
+CG_TARGET_AVX2 static void cg_convert_to_rgba_avx2(uint32_t * dst, const uint32_t * src, int len)
+{
+	__m256i mask = _mm256_set1_epi32(0xff);
+	__m256i half = _mm256_set1_epi32(0x8000);
+	int i = 0;
+	for(; i + 8 <= len; i += 8)
+	{
+		__m256i p = _mm256_loadu_si256((const __m256i *)(src + i));
+		__m256i a = _mm256_srli_epi32(p, 24);
+		__m256i inv = _mm256_i32gather_epi32((const int *)cg_unpremultiply_table, a, 4);
+		__m256i r = _mm256_and_si256(_mm256_srli_epi32(p, 16), mask);
+		__m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 8), mask);
+		__m256i b = _mm256_and_si256(p, mask);
+		r = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(r, inv), half), 16), mask);
+		g = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(g, inv), half), 16), mask);
+		b = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(b, inv), half), 16), mask);
+		p = _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(a, 24), _mm256_slli_epi32(b, 16)), _mm256_or_si256(_mm256_slli_epi32(g, 8), r));
+		_mm256_storeu_si256((__m256i *)(dst + i), p);
+	}
+	_mm256_zeroupper();
+	__cg_convert_to_rgba(dst + i, src + i, len - i);
+}
+#endif
+
+typedef void (*cg_convert_function_t)(uint32_t * dst, const uint32_t * src, int len);
+static cg_convert_function_t cg_convert_from_rgba = __cg_convert_from_rgba;
+static cg_convert_function_t cg_convert_to_rgba = __cg_convert_to_rgba;
 
 typedef void (*cg_comp_solid_function_t)(uint32_t * dst, int len, uint32_t color, uint32_t alpha);
-static const cg_comp_solid_function_t cg_comp_solid_map[] = {
+static cg_comp_solid_function_t cg_comp_solid_map[] = {
 	cg_comp_solid_source,
 	cg_comp_solid_source_over,
 	cg_comp_solid_destination_in,
 	cg_comp_solid_destination_out,
+	cg_comp_solid_clear,
+	cg_comp_solid_destination,
+	cg_comp_solid_source_in,
+	cg_comp_solid_source_out,
+	cg_comp_solid_source_atop,
+	cg_comp_solid_destination_over,
+	cg_comp_solid_destination_atop,
+	cg_comp_solid_xor,
+	cg_comp_solid_add,
+	cg_comp_solid_multiply,
+	cg_comp_solid_screen,
+	cg_comp_solid_overlay,
+	cg_comp_solid_darken,
+	cg_comp_solid_lighten,
+	cg_comp_solid_color_dodge,
+	cg_comp_solid_color_burn,
+	cg_comp_solid_hard_light,
+	cg_comp_solid_soft_light,
+	cg_comp_solid_difference,
+	cg_comp_solid_exclusion,
 };
 
 typedef void (*cg_comp_function_t)(uint32_t * dst, int len, uint32_t * src, uint32_t alpha);
-static const cg_comp_function_t cg_comp_map[] = {
+static cg_comp_function_t cg_comp_map[] = {
 	cg_comp_source,
 	cg_comp_source_over,
 	cg_comp_destination_in,
 	cg_comp_destination_out,
+	cg_comp_clear,
+	cg_comp_destination,
+	cg_comp_source_in,
+	cg_comp_source_out,
+	cg_comp_source_atop,
+	cg_comp_destination_over,
+	cg_comp_destination_atop,
+	cg_comp_xor,
+	cg_comp_add,
+	cg_comp_multiply,
+	cg_comp_screen,
+	cg_comp_overlay,
+	cg_comp_darken,
+	cg_comp_lighten,
+	cg_comp_color_dodge,
+	cg_comp_color_burn,
+	cg_comp_hard_light,
+	cg_comp_soft_light,
+	cg_comp_difference,
+	cg_comp_exclusion,
 };
 
-static inline void blend_solid(struct cg_surface_t * surface, enum cg_operator_t op, struct cg_rle_t * rle, uint32_t solid)
+typedef void (*cg_comp_solid_mask_function_t)(uint32_t * dst, int len, uint32_t color, const uint8_t * mask);
+static cg_comp_solid_mask_function_t cg_comp_solid_mask_map[] = {
+	cg_comp_solid_source_mask,
+	cg_comp_solid_source_over_mask,
+};
+
+static void cg_comp_init_once(void)
+{
+	cg_bicubic_init();
+	cg_unpremultiply_init();
+#ifdef CG_SIMD_X86
+	static const cg_comp_solid_function_t solid_builtin[] = {
+		__cg_comp_solid_source,
+		__cg_comp_solid_source_over,
+		__cg_comp_solid_destination_in,
+		__cg_comp_solid_destination_out,
+		__cg_comp_solid_clear,
+		__cg_comp_solid_destination,
+		__cg_comp_solid_source_in,
+		__cg_comp_solid_source_out,
+		__cg_comp_solid_source_atop,
+		__cg_comp_solid_destination_over,
+		__cg_comp_solid_destination_atop,
+		__cg_comp_solid_xor,
+		__cg_comp_solid_add,
+		__cg_comp_solid_multiply,
+		__cg_comp_solid_screen,
+		__cg_comp_solid_overlay,
+		__cg_comp_solid_darken,
+		__cg_comp_solid_lighten,
+		__cg_comp_solid_color_dodge,
+		__cg_comp_solid_color_burn,
+		__cg_comp_solid_hard_light,
+		__cg_comp_solid_soft_light,
+		__cg_comp_solid_difference,
+		__cg_comp_solid_exclusion,
+	};
+	static const cg_comp_solid_function_t solid_sse2[] = {
+		cg_comp_solid_source_sse2,
+		cg_comp_solid_source_over_sse2,
+		cg_comp_solid_destination_in_sse2,
+		cg_comp_solid_destination_out_sse2,
+		cg_comp_solid_clear_sse2,
+		__cg_comp_solid_destination,
+		cg_comp_solid_source_in_sse2,
+		cg_comp_solid_source_out_sse2,
+		cg_comp_solid_source_atop_sse2,
+		cg_comp_solid_destination_over_sse2,
+		cg_comp_solid_destination_atop_sse2,
+		cg_comp_solid_xor_sse2,
+		cg_comp_solid_add_sse2,
+		cg_comp_solid_multiply_sse2,
+		cg_comp_solid_screen_sse2,
+		cg_comp_solid_overlay_sse2,
+		cg_comp_solid_darken_sse2,
+		cg_comp_solid_lighten_sse2,
+		__cg_comp_solid_color_dodge,
+		__cg_comp_solid_color_burn,
+		cg_comp_solid_hard_light_sse2,
+		__cg_comp_solid_soft_light,
+		cg_comp_solid_difference_sse2,
+		cg_comp_solid_exclusion_sse2,
+	};
+	static const cg_comp_solid_function_t solid_avx2[] = {
+		cg_comp_solid_source_avx2,
+		cg_comp_solid_source_over_avx2,
+		cg_comp_solid_destination_in_avx2,
+		cg_comp_solid_destination_out_avx2,
+		cg_comp_solid_clear_avx2,
+		__cg_comp_solid_destination,
+		cg_comp_solid_source_in_avx2,
+		cg_comp_solid_source_out_avx2,
+		cg_comp_solid_source_atop_avx2,
+		cg_comp_solid_destination_over_avx2,
+		cg_comp_solid_destination_atop_avx2,
+		cg_comp_solid_xor_avx2,
+		cg_comp_solid_add_avx2,
+		cg_comp_solid_multiply_avx2,
+		cg_comp_solid_screen_avx2,
+		cg_comp_solid_overlay_avx2,
+		cg_comp_solid_darken_avx2,
+		cg_comp_solid_lighten_avx2,
+		__cg_comp_solid_color_dodge,
+		__cg_comp_solid_color_burn,
+		cg_comp_solid_hard_light_avx2,
+		__cg_comp_solid_soft_light,
+		cg_comp_solid_difference_avx2,
+		cg_comp_solid_exclusion_avx2,
+	};
+	static const cg_comp_function_t builtin[] = {
+		__cg_comp_source,
+		__cg_comp_source_over,
+		__cg_comp_destination_in,
+		__cg_comp_destination_out,
+		__cg_comp_clear,
+		__cg_comp_destination,
+		__cg_comp_source_in,
+		__cg_comp_source_out,
+		__cg_comp_source_atop,
+		__cg_comp_destination_over,
+		__cg_comp_destination_atop,
+		__cg_comp_xor,
+		__cg_comp_add,
+		__cg_comp_multiply,
+		__cg_comp_screen,
+		__cg_comp_overlay,
+		__cg_comp_darken,
+		__cg_comp_lighten,
+		__cg_comp_color_dodge,
+		__cg_comp_color_burn,
+		__cg_comp_hard_light,
+		__cg_comp_soft_light,
+		__cg_comp_difference,
+		__cg_comp_exclusion,
+	};
+	static const cg_comp_function_t sse2[] = {
+		cg_comp_source_sse2,
+		cg_comp_source_over_sse2,
+		cg_comp_destination_in_sse2,
+		cg_comp_destination_out_sse2,
+		cg_comp_clear_sse2,
+		__cg_comp_destination,
+		cg_comp_source_in_sse2,
+		cg_comp_source_out_sse2,
+		cg_comp_source_atop_sse2,
+		cg_comp_destination_over_sse2,
+		cg_comp_destination_atop_sse2,
+		cg_comp_xor_sse2,
+		cg_comp_add_sse2,
+		cg_comp_multiply_sse2,
+		cg_comp_screen_sse2,
+		cg_comp_overlay_sse2,
+		cg_comp_darken_sse2,
+		cg_comp_lighten_sse2,
+		__cg_comp_color_dodge,
+		__cg_comp_color_burn,
+		cg_comp_hard_light_sse2,
+		__cg_comp_soft_light,
+		cg_comp_difference_sse2,
+		cg_comp_exclusion_sse2,
+	};
+	static const cg_comp_function_t avx2[] = {
+		cg_comp_source_avx2,
+		cg_comp_source_over_avx2,
+		cg_comp_destination_in_avx2,
+		cg_comp_destination_out_avx2,
+		cg_comp_clear_avx2,
+		__cg_comp_destination,
+		cg_comp_source_in_avx2,
+		cg_comp_source_out_avx2,
+		cg_comp_source_atop_avx2,
+		cg_comp_destination_over_avx2,
+		cg_comp_destination_atop_avx2,
+		cg_comp_xor_avx2,
+		cg_comp_add_avx2,
+		cg_comp_multiply_avx2,
+		cg_comp_screen_avx2,
+		cg_comp_overlay_avx2,
+		cg_comp_darken_avx2,
+		cg_comp_lighten_avx2,
+		__cg_comp_color_dodge,
+		__cg_comp_color_burn,
+		cg_comp_hard_light_avx2,
+		__cg_comp_soft_light,
+		cg_comp_difference_avx2,
+		cg_comp_exclusion_avx2,
+	};
+	static const cg_comp_solid_mask_function_t mask_builtin[] = {
+		__cg_comp_solid_source_mask,
+		__cg_comp_solid_source_over_mask,
+	};
+	static const cg_comp_solid_mask_function_t mask_sse2[] = {
+		cg_comp_solid_source_mask_sse2,
+		cg_comp_solid_source_over_mask_sse2,
+	};
+	static const cg_comp_solid_mask_function_t mask_avx2[] = {
+		cg_comp_solid_source_mask_avx2,
+		cg_comp_solid_source_over_mask_avx2,
+	};
+	const cg_comp_solid_function_t * solid = NULL;
+	const cg_comp_function_t * span = NULL;
+	const cg_comp_solid_mask_function_t * mask = NULL;
+
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2"))
+	{
+		solid = solid_avx2;
+		span = avx2;
+		mask = mask_avx2;
+		cg_gradient_fetch_linear = cg_gradient_fetch_linear_avx2;
+		cg_gradient_fetch_radial = cg_gradient_fetch_radial_avx2;
+		cg_texture_fetch_bilinear = cg_texture_fetch_bilinear_sse2;
+		cg_texture_fetch_bicubic = cg_texture_fetch_bicubic_sse2;
+		cg_convert_from_rgba = cg_convert_from_rgba_avx2;
+		cg_convert_to_rgba = cg_convert_to_rgba_avx2;
+	}
+	else if(__builtin_cpu_supports("sse2"))
+	{
+		solid = solid_sse2;
+		span = sse2;
+		mask = mask_sse2;
+		cg_gradient_fetch_linear = cg_gradient_fetch_linear_sse2;
+		cg_gradient_fetch_radial = cg_gradient_fetch_radial_sse2;
+		cg_texture_fetch_bilinear = cg_texture_fetch_bilinear_sse2;
+		cg_texture_fetch_bicubic = cg_texture_fetch_bicubic_sse2;
+		cg_convert_from_rgba = cg_convert_from_rgba_sse2;
+	}
+	if(solid && span && mask)
+	{
+		for(int i = 0; i < (int)(sizeof(mask_builtin) / sizeof(mask_builtin[0])); i++)
+		{
+			if(cg_comp_solid_mask_map[i] == mask_builtin[i])
+				cg_comp_solid_mask_map[i] = mask[i];
+		}
+		for(int i = 0; i < (int)(sizeof(builtin) / sizeof(builtin[0])); i++)
+		{
+			if(cg_comp_solid_map[i] == solid_builtin[i])
+				cg_comp_solid_map[i] = solid[i];
+			if(cg_comp_map[i] == builtin[i])
+				cg_comp_map[i] = span[i];
+		}
+	}
+#endif
+}
+
+static void cg_comp_init(void)
+{
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+	pthread_once(&once, cg_comp_init_once);
+}
+
+void cg_surface_convert_from_rgba(struct cg_surface_t * surface, const void * rgba, int stride)
+{
+	cg_comp_init();
+	for(int y = 0; y < surface->height; y++)
+		cg_convert_from_rgba((uint32_t *)((uint8_t *)surface->pixels + surface->stride * y), (const uint32_t *)((const uint8_t *)rgba + stride * y), surface->width);
+	cg_surface_mark_dirty(surface);
+}
+
+void cg_surface_convert_to_rgba(struct cg_surface_t * surface, void * rgba, int stride)
+{
+	cg_comp_init();
+	for(int y = 0; y < surface->height; y++)
+		cg_convert_to_rgba((uint32_t *)((uint8_t *)rgba + stride * y), (const uint32_t *)((uint8_t *)surface->pixels + surface->stride * y), surface->width);
+}
+
+static inline void cg_comp_span(cg_comp_function_t func, enum cg_operator_t op, uint32_t * dst, int len, uint32_t * src, uint32_t alpha)
+{
+	if((op == CG_OPERATOR_SRC_OVER) && (len < 16))
+		__cg_comp_source_over(dst, len, src, alpha);
+	else
+		func(dst, len, src, alpha);
+}
+
+static inline void blend_solid_source(struct cg_surface_t * surface, enum cg_operator_t op, struct cg_rle_t * rle, uint32_t solid)
 {
 	cg_comp_solid_function_t func = cg_comp_solid_map[op];
+	uint8_t mask[256];
 	int count = rle->spans.size;
 	struct cg_span_t * spans = rle->spans.data;
-	while(count--)
+	while(count > 0)
 	{
 		uint32_t * target = (uint32_t *)(surface->pixels + spans->y * surface->stride) + spans->x;
-		func(target, spans->len, solid, spans->coverage);
-		++spans;
+		int len = spans->len;
+		int n = 1;
+		if(len >= 16)
+		{
+			func(target, len, solid, spans->coverage);
+		}
+		else if((count > 8) && (spans[8].y == spans->y) && (spans[8].x == spans->x + len + 7) && (spans[1].len == 1) && (spans[1].x == spans->x + len))
+		{
+			int length = 0;
+			for(int k = 0; k < len; k++)
+				mask[length++] = spans->coverage;
+			while((n < count) && (spans[n].len == 1) && (spans[n].y == spans->y) && (spans[n].x == spans->x + length) && (length < 256))
+				mask[length++] = spans[n++].coverage;
+			cg_comp_solid_mask_map[op](target, length, solid, mask);
+		}
+		else
+		{
+			uint32_t color = (spans->coverage == 255) ? solid : CG_BYTE_MUL(solid, spans->coverage);
+			uint32_t ialpha = (op == CG_OPERATOR_SRC) ? 255 - spans->coverage : 255 - CG_ALPHA(color);
+			if(ialpha == 0)
+			{
+				for(int i = 0; i < len; i++)
+					target[i] = color;
+			}
+			else
+			{
+				for(int i = 0; i < len; i++)
+					target[i] = color + CG_BYTE_MUL(target[i], ialpha);
+			}
+		}
+		spans += n;
+		count -= n;
+	}
+}
+
+static inline void blend_solid(struct cg_surface_t * surface, enum cg_operator_t op, struct cg_rle_t * rle, uint32_t solid)
+{
+	if(op == CG_OPERATOR_SRC)
+	{
+		blend_solid_source(surface, CG_OPERATOR_SRC, rle, solid);
+	}
+	else if(op == CG_OPERATOR_SRC_OVER)
+	{
+		blend_solid_source(surface, CG_OPERATOR_SRC_OVER, rle, solid);
+	}
+	else
+	{
+		cg_comp_solid_function_t func = cg_comp_solid_map[op];
+		int count = rle->spans.size;
+		struct cg_span_t * spans = rle->spans.data;
+		while(count--)
+		{
+			uint32_t * target = (uint32_t *)(surface->pixels + spans->y * surface->stride) + spans->x;
+			func(target, spans->len, solid, spans->coverage);
+			++spans;
+		}
 	}
 }
 
@@ -1844,7 +4776,7 @@ static inline void blend_linear_gradient(struct cg_surface_t * surface, enum cg_
 			int l = CG_MIN(length, 1024);
 			fetch_linear_gradient(buffer, &v, gradient, spans->y, x, l);
 			uint32_t * target = (uint32_t *)(surface->pixels + spans->y * surface->stride) + x;
-			func(target, l, buffer, spans->coverage);
+			cg_comp_span(func, op, target, l, buffer, spans->coverage);
 			x += l;
 			length -= l;
 		}
@@ -1877,7 +4809,7 @@ static inline void blend_radial_gradient(struct cg_surface_t * surface, enum cg_
 			int l = CG_MIN(length, 1024);
 			fetch_radial_gradient(buffer, &v, gradient, spans->y, x, l);
 			uint32_t * target = (uint32_t *)(surface->pixels + spans->y * surface->stride) + x;
-			func(target, l, buffer, spans->coverage);
+			cg_comp_span(func, op, target, l, buffer, spans->coverage);
 			x += l;
 			length -= l;
 		}
@@ -1885,7 +4817,6 @@ static inline void blend_radial_gradient(struct cg_surface_t * surface, enum cg_
 	}
 }
 
-#define FIXED_SCALE (1 << 16)
 static inline void blend_untransformed_argb(struct cg_surface_t * surface, enum cg_operator_t op, struct cg_rle_t * rle, struct cg_texture_data_t * texture)
 {
 	cg_comp_function_t func = cg_comp_map[op];
@@ -1917,7 +4848,7 @@ static inline void blend_untransformed_argb(struct cg_surface_t * surface, enum
 				int coverage = (spans->coverage * texture->alpha) >> 8;
 				uint32_t * src = (uint32_t *)(texture->pixels + sy * texture->stride) + sx;
 				uint32_t * dst = (uint32_t *)(surface->pixels + spans->y * surface->stride) + x;
-				func(dst, length, src, coverage);
+				cg_comp_span(func, op, dst, length, src, coverage);
 			}
 		}
 		++spans;
@@ -1966,7 +4897,7 @@ static inline void blend_transformed_argb(struct cg_surface_t * surface, enum cg
 				if(clen == 0)
 					start++;
 			}
-			func(target + start, clen, buffer + start, coverage);
+			cg_comp_span(func, op, target + start, clen, buffer + start, coverage);
 			target += l;
 			length -= l;
 		}
@@ -2006,7 +4937,7 @@ static inline void blend_untransformed_tiled_argb(struct cg_surface_t * surface,
 				l = 1024;
 			uint32_t * src = (uint32_t *)(texture->pixels + sy * texture->stride) + sx;
 			uint32_t * dst = (uint32_t *)(surface->pixels + spans->y * surface->stride) + x;
-			func(dst, l, src, coverage);
+			cg_comp_span(func, op, dst, l, src, coverage);
 			x += l;
 			length -= l;
 			sx = 0;
@@ -2067,7 +4998,7 @@ static inline void blend_transformed_tiled_argb(struct cg_surface_t * surface, e
 					py16 -= image_height << 16;
 				++b;
 			}
-			func(target, l, buffer, coverage);
+			cg_comp_span(func, op, target, l, buffer, coverage);
 			target += l;
 			length -= l;
 		}
@@ -2085,57 +5016,81 @@ static inline void cg_blend_color(struct cg_ctx_t * ctx, struct cg_rle_t * rle,
 	}
 }
 
-static inline void cg_blend_gradient(struct cg_ctx_t * ctx, struct cg_rle_t * rle, struct cg_gradient_t * gradient)
+static void cg_gradient_build_colortable(uint32_t * colortable, struct cg_gradient_t * gradient, double opacity)
 {
-	if(gradient && (gradient->stops.size > 0))
-	{
-		struct cg_state_t * state = ctx->state;
-		struct cg_gradient_data_t data;
-		int i, pos = 0, nstop = gradient->stops.size;
-		struct cg_gradient_stop_t *curr, *next, *start, *last;
-		uint32_t curr_color, next_color, last_color;
-		uint32_t dist, idist;
-		double delta, t, incr, fpos;
-		double opacity = state->opacity * gradient->opacity;
+	int i, pos = 0, nstop = gradient->stops.size;
+	struct cg_gradient_stop_t *curr, *next, *start, *last;
+	uint32_t curr_color, next_color, last_color;
+	uint32_t dist, idist;
+	double delta, t, incr, fpos;
 
-		start = gradient->stops.data;
-		curr = start;
-		curr_color = combine_opacity(&curr->color, opacity);
+	start = gradient->stops.data;
+	curr = start;
+	curr_color = combine_opacity(&curr->color, opacity);
 
-		data.colortable[pos] = premultiply_pixel(curr_color);
-		++pos;
-		incr = 1.0 / 1024;
-		fpos = 1.5 * incr;
+	colortable[pos] = premultiply_pixel(curr_color);
+	++pos;
+	incr = 1.0 / 1024;
+	fpos = 1.5 * incr;
 
-		while(fpos <= curr->offset)
+	while(fpos <= curr->offset)
+	{
+		colortable[pos] = colortable[pos - 1];
+		++pos;
+		fpos += incr;
+	}
+	for(i = 0; i < nstop - 1; i++)
+	{
+		curr = (start + i);
+		next = (start + i + 1);
+		delta = 1.0 / (next->offset - curr->offset);
+		next_color = combine_opacity(&next->color, opacity);
+		while(fpos < next->offset && pos < 1024)
 		{
-			data.colortable[pos] = data.colortable[pos - 1];
+			t = (fpos - curr->offset) * delta;
+			dist = (uint32_t)(255 * t);
+			idist = 255 - dist;
+			colortable[pos] = premultiply_pixel(interpolate_pixel(curr_color, idist, next_color, dist));
 			++pos;
 			fpos += incr;
 		}
-		for(i = 0; i < nstop - 1; i++)
+		curr_color = next_color;
+	}
+
+	last = start + nstop - 1;
+	last_color = premultiply_color(&last->color, opacity);
+	for(; pos < 1024; ++pos)
+		colortable[pos] = last_color;
+}
+
+static void cg_gradient_update(struct cg_gradient_t * gradient, double opacity)
+{
+	if(gradient && (gradient->stops.size > 0) && (gradient->colortable_opacity != opacity))
+	{
+		if(!gradient->colortable)
+			gradient->colortable = malloc(sizeof(uint32_t) * 1024);
+		cg_gradient_build_colortable(gradient->colortable, gradient, opacity);
+		gradient->colortable_opacity = opacity;
+	}
+}
+
+static inline void cg_blend_gradient(struct cg_ctx_t * ctx, struct cg_rle_t * rle, struct cg_gradient_t * gradient)
+{
+	if(gradient && (gradient->stops.size > 0))
+	{
+		struct cg_state_t * state = ctx->state;
+		struct cg_gradient_data_t data;
+		uint32_t colortable[1024];
+		double opacity = state->opacity * gradient->opacity;
+
+		if(gradient->colortable && (gradient->colortable_opacity == opacity))
+			data.colortable = gradient->colortable;
+		else
 		{
-			curr = (start + i);
-			next = (start + i + 1);
-			delta = 1.0 / (next->offset - curr->offset);
-			next_color = combine_opacity(&next->color, opacity);
-			while(fpos < next->offset && pos < 1024)
-			{
-				t = (fpos - curr->offset) * delta;
-				dist = (uint32_t)(255 * t);
-				idist = 255 - dist;
-				data.colortable[pos] = premultiply_pixel(interpolate_pixel(curr_color, idist, next_color, dist));
-				++pos;
-				fpos += incr;
-			}
-			curr_color = next_color;
+			cg_gradient_build_colortable(colortable, gradient, opacity);
+			data.colortable = colortable;
 		}
 
-		last = start + nstop - 1;
-		last_color = premultiply_color(&last->color, opacity);
-		for(; pos < 1024; ++pos)
-			data.colortable[pos] = last_color;
-
 		data.spread = gradient->spread;
 		data.matrix = gradient->matrix;
 		cg_matrix_multiply(&data.matrix, &data.matrix, &state->matrix);
@@ -2162,22 +5117,109 @@ static inline void cg_blend_gradient(struct cg_ctx_t * ctx, struct cg_rle_t * rl
 	}
 }
 
+static void cg_source_update(struct cg_ctx_t * ctx)
+{
+	struct cg_state_t * state = ctx->state;
+	struct cg_gradient_t * gradient = cg_paint_get_gradient(state->source);
+	struct cg_texture_t * texture = cg_paint_get_texture(state->source);
+	if(gradient)
+		cg_gradient_update(gradient, state->opacity * gradient->opacity);
+	else if(texture)
+		cg_texture_update(texture, &state->matrix);
+}
+
+static inline void blend_filtered_argb(struct cg_surface_t * surface, enum cg_operator_t op, struct cg_rle_t * rle, struct cg_texture_data_t * texture, enum cg_texture_filter_t filter)
+{
+	cg_comp_function_t func = cg_comp_map[op];
+	cg_texture_fetch_function_t fetch = (filter == CG_TEXTURE_FILTER_BICUBIC) ? cg_texture_fetch_bicubic : cg_texture_fetch_bilinear;
+	uint32_t buffer[1024];
+
+	int margin = (filter == CG_TEXTURE_FILTER_BICUBIC) ? 2 : 1;
+	int image_width = texture->width;
+	int image_height = texture->height;
+	int fdx = (int)(texture->matrix.a * FIXED_SCALE);
+	int fdy = (int)(texture->matrix.b * FIXED_SCALE);
+	int count = rle->spans.size;
+	struct cg_span_t * spans = rle->spans.data;
+	while(count--)
+	{
+		uint32_t * target = (uint32_t *)(surface->pixels + spans->y * surface->stride) + spans->x;
+		double cx = spans->x + 0.5;
+		double cy = spans->y + 0.5;
+		int x = (int)((texture->matrix.c * cy + texture->matrix.a * cx + texture->matrix.tx) * FIXED_SCALE);
+		int y = (int)((texture->matrix.d * cy + texture->matrix.b * cx + texture->matrix.ty) * FIXED_SCALE);
+		int length = spans->len;
+		int coverage = (spans->coverage * texture->alpha) >> 8;
+		while(length)
+		{
+			int l = CG_MIN(length, 1024);
+			int start = 0;
+			int end = l;
+			if(!texture->tiled)
+			{
+				int u = x - FIXED_SCALE / 2;
+				int v = y - FIXED_SCALE / 2;
+				end = 0;
+				start = -1;
+				for(int i = 0; i < l; i++, u += fdx, v += fdy)
+				{
+					int px = u >> 16;
+					int py = v >> 16;
+					if((px >= -margin) && (px < image_width + margin - 1) && (py >= -margin) && (py < image_height + margin - 1))
+					{
+						if(start < 0)
+							start = i;
+						end = i + 1;
+					}
+				}
+				if(start < 0)
+					start = 0;
+			}
+			if(end > start)
+			{
+				fetch(buffer, texture, x + fdx * start, y + fdy * start, fdx, fdy, end - start);
+				cg_comp_span(func, op, target + start, end - start, buffer, coverage);
+			}
+			x += fdx * l;
+			y += fdy * l;
+			target += l;
+			length -= l;
+		}
+		++spans;
+	}
+}
+
 static inline void cg_blend_texture(struct cg_ctx_t * ctx, struct cg_rle_t * rle, struct cg_texture_t * texture)
 {
 	if(texture)
 	{
 		struct cg_state_t * state = ctx->state;
 		struct cg_texture_data_t data;
-		data.width = texture->surface->width;
-		data.height = texture->surface->height;
-		data.stride = texture->surface->stride;
-		data.alpha = (int)(state->opacity * texture->opacity * 256.0);
-		data.pixels = texture->surface->pixels;
+		struct cg_surface_t * surface = texture->surface;
 		data.matrix = texture->matrix;
 		cg_matrix_multiply(&data.matrix, &data.matrix, &state->matrix);
 		cg_matrix_invert(&data.matrix);
 		struct cg_matrix_t * m = &data.matrix;
-		if((m->a == 1.0) && (m->b == 0.0) && (m->c == 0.0) && (m->d == 1.0))
+		int level = cg_texture_level(m, texture->nlevel);
+		if(level > 0)
+		{
+			surface = texture->levels[level - 1];
+			double sx = (double)surface->width / (double)texture->surface->width;
+			double sy = (double)surface->height / (double)texture->surface->height;
+			m->a *= sx; m->c *= sx; m->tx *= sx;
+			m->b *= sy; m->d *= sy; m->ty *= sy;
+		}
+		data.width = surface->width;
+		data.height = surface->height;
+		data.stride = surface->stride;
+		data.alpha = (int)(state->opacity * texture->opacity * 256.0);
+		data.tiled = (texture->type == CG_TEXTURE_TYPE_TILED);
+		data.pixels = surface->pixels;
+		if((texture->filter != CG_TEXTURE_FILTER_NEAREST) && !((m->a == 1.0) && (m->b == 0.0) && (m->c == 0.0) && (m->d == 1.0) && (m->tx == floor(m->tx)) && (m->ty == floor(m->ty))))
+		{
+			blend_filtered_argb(ctx->surface, state->op, rle, &data, texture->filter);
+		}
+		else if((m->a == 1.0) && (m->b == 0.0) && (m->c == 0.0) && (m->d == 1.0))
 		{
 			if(texture->type == CG_TEXTURE_TYPE_PLAIN)
 				blend_untransformed_argb(ctx->surface, state->op, rle, &data);
@@ -2216,13 +5258,278 @@ static void cg_blend(struct cg_ctx_t * ctx, struct cg_rle_t * rle)
 	}
 }
 
+#define CG_BAND_HEIGHT		(32)
+
+typedef void (*cg_pool_func_t)(void * data, int index, int slot);
+
+struct cg_pool_t {
+	pthread_t * threads;
+	int nthread;
+	struct cg_rle_t ** rles;
+	SW_FT_Raster * rasters;
+	struct cg_scratch_t ** scratches;
+	int nslot;
+	int started;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	pthread_cond_t done;
+	cg_pool_func_t func;
+	void * data;
+	int count;
+	int next;
+	int pending;
+	int quit;
+};
+
+static void * cg_pool_worker(void * arg)
+{
+	struct cg_pool_t * pool = arg;
+	pthread_mutex_lock(&pool->mutex);
+	int slot = ++pool->started;
+	for(;;)
+	{
+		while(!pool->quit && (pool->next >= pool->count))
+			pthread_cond_wait(&pool->cond, &pool->mutex);
+		if(pool->quit)
+			break;
+		int index = pool->next++;
+		pthread_mutex_unlock(&pool->mutex);
+		pool->func(pool->data, index, slot);
+		pthread_mutex_lock(&pool->mutex);
+		if(--pool->pending == 0)
+			pthread_cond_signal(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return NULL;
+}
+
+static struct cg_pool_t * cg_pool_create(int threads)
+{
+	struct cg_pool_t * pool = malloc(sizeof(struct cg_pool_t));
+	pool->threads = malloc(sizeof(pthread_t) * (threads - 1));
+	pool->nthread = 0;
+	pool->rles = malloc(sizeof(struct cg_rle_t *) * threads);
+	pool->rasters = malloc(sizeof(SW_FT_Raster) * threads);
+	pool->scratches = malloc(sizeof(struct cg_scratch_t *) * threads);
+	pool->nslot = threads;
+	pool->started = 0;
+	for(int i = 0; i < threads; i++)
+	{
+		pool->rles[i] = cg_rle_create();
+		sw_ft_grays_raster.raster_new(&pool->rasters[i]);
+		pool->scratches[i] = cg_scratch_create();
+	}
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	pool->func = NULL;
+	pool->data = NULL;
+	pool->count = 0;
+	pool->next = 0;
+	pool->pending = 0;
+	pool->quit = 0;
+	for(int i = 0; i < threads - 1; i++)
+	{
+		if(pthread_create(&pool->threads[pool->nthread], NULL, cg_pool_worker, pool) != 0)
+			break;
+		pool->nthread++;
+	}
+	return pool;
+}
+
+static void cg_pool_destroy(struct cg_pool_t * pool)
+{
+	if(pool)
+	{
+		pthread_mutex_lock(&pool->mutex);
+		pool->quit = 1;
+		pthread_cond_broadcast(&pool->cond);
+		pthread_mutex_unlock(&pool->mutex);
+		for(int i = 0; i < pool->nthread; i++)
+			pthread_join(pool->threads[i], NULL);
+		for(int i = 0; i < pool->nslot; i++)
+		{
+			cg_rle_destroy(pool->rles[i]);
+			sw_ft_grays_raster.raster_done(pool->rasters[i]);
+			cg_scratch_destroy(pool->scratches[i]);
+		}
+		pthread_mutex_destroy(&pool->mutex);
+		pthread_cond_destroy(&pool->cond);
+		pthread_cond_destroy(&pool->done);
+		free(pool->rles);
+		free(pool->rasters);
+		free(pool->scratches);
+		free(pool->threads);
+		free(pool);
+	}
+}
+
+static void cg_pool_run(struct cg_pool_t * pool, int count, cg_pool_func_t func, void * data)
+{
+	pthread_mutex_lock(&pool->mutex);
+	pool->func = func;
+	pool->data = data;
+	pool->count = count;
+	pool->next = 0;
+	pool->pending = count;
+	pthread_cond_broadcast(&pool->cond);
+	while(pool->next < pool->count)
+	{
+		int index = pool->next++;
+		pthread_mutex_unlock(&pool->mutex);
+		func(data, index, 0);
+		pthread_mutex_lock(&pool->mutex);
+		--pool->pending;
+	}
+	while(pool->pending > 0)
+		pthread_cond_wait(&pool->done, &pool->mutex);
+	pool->count = 0;
+	pool->next = 0;
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+static int cg_pool_bands(struct cg_ctx_t * ctx, int h)
+{
+	if(!ctx->pool || (h < CG_BAND_HEIGHT * 2))
+		return 0;
+	struct cg_paint_t * source = ctx->state->source;
+	if((source->type == CG_PAINT_TYPE_TEXTURE) && source->texture && (source->texture->surface == ctx->surface))
+		return 0;
+	return CG_MIN(ctx->pool->nslot, h / CG_BAND_HEIGHT);
+}
+
+struct cg_band_task_t {
+	struct cg_ctx_t * ctx;
+	const void * source;
+	int flags;
+	struct cg_rle_t * rle;
+	int y;
+	int h;
+	int count;
+};
+
+static void cg_band_render(void * data, int index, int slot)
+{
+	struct cg_band_task_t * task = data;
+	struct cg_ctx_t * ctx = task->ctx;
+	struct cg_rle_t * rle = ctx->pool->rles[slot];
+	int y1 = task->y + task->h * index / task->count;
+	int y2 = task->y + task->h * (index + 1) / task->count;
+	struct cg_rect_t clip;
+	cg_rect_init(&clip, ctx->clip.x, y1, ctx->clip.w, y2 - y1);
+	cg_rle_clear(rle);
+	cg_rle_rasterize_source(rle, ctx->pool->rasters[slot], task->source, task->flags, &clip);
+	if(task->rle)
+	{
+		struct cg_rle_t slice;
+		cg_rle_slice(&slice, task->rle, y1, y2);
+		cg_rle_intersect(rle, &slice, ctx->pool->scratches[slot]->rle);
+	}
+	cg_blend(ctx, rle);
+}
+
+static void cg_band_blend(void * data, int index, int slot)
+{
+	struct cg_band_task_t * task = data;
+	struct cg_rle_t * rle = task->rle;
+	int i = rle->spans.size * index / task->count;
+	int j = rle->spans.size * (index + 1) / task->count;
+	struct cg_rle_t slice;
+	slice.spans.data = rle->spans.data + i;
+	slice.spans.size = j - i;
+	slice.spans.capacity = j - i;
+	slice.x = rle->x;
+	slice.y = rle->y;
+	slice.w = rle->w;
+	slice.h = rle->h;
+	cg_blend(task->ctx, &slice);
+}
+
+static void cg_render_source(struct cg_ctx_t * ctx, const void * source, int flags)
+{
+	struct cg_band_task_t task;
+	int count = 0;
+	flags |= cg_raster_flags(ctx);
+	if(ctx->pool)
+	{
+		SW_FT_BBox cbox;
+		if(flags & SW_FT_RASTER_FLAG_STROKER)
+			SW_FT_Stroker_GetCBox((SW_FT_Stroker)source, &cbox);
+		else if(flags & SW_FT_RASTER_FLAG_POLYGON)
+			SW_FT_Polygon_Get_CBox(source, &cbox);
+		else
+			SW_FT_Outline_Get_CBox(source, &cbox);
+		int y1 = CG_MAX((int)(cbox.yMin >> 6), (int)ctx->clip.y);
+		int y2 = CG_MIN((int)((cbox.yMax + 63) >> 6), (int)(ctx->clip.y + ctx->clip.h));
+		count = cg_pool_bands(ctx, y2 - y1);
+		task.y = y1;
+		task.h = y2 - y1;
+	}
+	if(count > 1)
+	{
+		task.ctx = ctx;
+		task.source = source;
+		task.flags = flags;
+		task.rle = ctx->state->clippath;
+		task.count = count;
+		cg_pool_run(ctx->pool, count, cg_band_render, &task);
+	}
+	else
+	{
+		cg_rle_clear(ctx->rle);
+		cg_rle_rasterize_source(ctx->rle, ctx->raster, source, flags, &ctx->clip);
+		cg_rle_intersect(ctx->rle, ctx->state->clippath, ctx->scratch->rle);
+		cg_blend(ctx, ctx->rle);
+	}
+}
+
+static void cg_render_rle(struct cg_ctx_t * ctx, struct cg_rle_t * rle)
+{
+	int count = (rle && (rle->spans.size > 0)) ? cg_pool_bands(ctx, rle->h) : 0;
+	if(count > 1)
+	{
+		struct cg_band_task_t task;
+		task.ctx = ctx;
+		task.source = NULL;
+		task.flags = 0;
+		task.rle = rle;
+		task.y = rle->y;
+		task.h = rle->h;
+		task.count = count;
+		cg_pool_run(ctx->pool, count, cg_band_blend, &task);
+	}
+	else
+	{
+		cg_blend(ctx, rle);
+	}
+}
+
+static void cg_render_paint(struct cg_ctx_t * ctx)
+{
+	struct cg_state_t * state = ctx->state;
+	if(state->clippath == NULL)
+	{
+		if(ctx->clippath == NULL)
+			ctx->clippath = cg_rle_create();
+		if((ctx->clippath->x != (int)ctx->clip.x) || (ctx->clippath->y != (int)ctx->clip.y) || (ctx->clippath->w != (int)ctx->clip.w) || (ctx->clippath->h != (int)ctx->clip.h))
+		{
+			cg_rle_clear(ctx->clippath);
+			cg_rle_rectangle(ctx->clippath, FT_COORD(ctx->clip.x), FT_COORD(ctx->clip.y), FT_COORD(ctx->clip.x + ctx->clip.w), FT_COORD(ctx->clip.y + ctx->clip.h), -1, &ctx->clip);
+		}
+	}
+	struct cg_rle_t * rle = state->clippath ? state->clippath : ctx->clippath;
+	cg_render_rle(ctx, rle);
+}
+
 static struct cg_state_t * cg_state_create(void)
 {
 	struct cg_state_t * state = malloc(sizeof(struct cg_state_t));
 	state->clippath = NULL;
+	cg_rect_init(&state->clip, 0, 0, 0, 0);
 	state->source = cg_paint_create_rgba(0, 0, 0, 1.0);
 	cg_matrix_init_identity(&state->matrix);
 	state->winding = CG_FILL_RULE_NON_ZERO;
+	state->antialias = CG_ANTIALIAS_DEFAULT;
 	state->stroke.width = 1.0;
 	state->stroke.miterlimit = 10.0;
 	state->stroke.cap = CG_LINE_CAP_BUTT;
@@ -2230,6 +5537,7 @@ static struct cg_state_t * cg_state_create(void)
 	state->stroke.dash = NULL;
 	state->op = CG_OPERATOR_SRC_OVER;
 	state->opacity = 1.0;
+	state->tolerance = 0.1;
 	state->next = NULL;
 	return state;
 }
@@ -2237,17 +5545,20 @@ static struct cg_state_t * cg_state_create(void)
 static struct cg_state_t * cg_state_clone(struct cg_state_t * state)
 {
 	struct cg_state_t * newstate = malloc(sizeof(struct cg_state_t));
-	newstate->clippath = cg_rle_clone(state->clippath);
+	newstate->clippath = cg_rle_reference(state->clippath);
+	newstate->clip = state->clip;
 	newstate->source = cg_paint_reference(state->source);
 	newstate->matrix = state->matrix;
 	newstate->winding = state->winding;
+	newstate->antialias = state->antialias;
 	newstate->stroke.width = state->stroke.width;
 	newstate->stroke.miterlimit = state->stroke.miterlimit;
 	newstate->stroke.cap = state->stroke.cap;
 	newstate->stroke.join = state->stroke.join;
-	newstate->stroke.dash = cg_dash_clone(state->stroke.dash);
+	newstate->stroke.dash = cg_dash_reference(state->stroke.dash);
 	newstate->op = state->op;
 	newstate->opacity = state->opacity;
+	newstate->tolerance = state->tolerance;
 	newstate->next = NULL;
 	return newstate;
 }
@@ -2260,15 +5571,460 @@ static void cg_state_destroy(struct cg_state_t * state)
 	free(state);
 }
 
+#define CG_TILE_HEIGHT		(64)
+
+enum cg_command_type_t {
+	CG_COMMAND_SAVE			= 0,
+	CG_COMMAND_RESTORE		= 1,
+	CG_COMMAND_CLIP			= 2,
+	CG_COMMAND_RESET_CLIP	= 3,
+	CG_COMMAND_FILL			= 4,
+	CG_COMMAND_STROKE		= 5,
+	CG_COMMAND_PAINT		= 6,
+};
+
+struct cg_command_t {
+	enum cg_command_type_t type;
+	enum cg_fill_rule_t winding;
+	enum cg_antialias_t antialias;
+	enum cg_operator_t op;
+	double opacity;
+	double tolerance;
+	struct cg_matrix_t matrix;
+	struct cg_paint_t * paint;
+	struct cg_stroke_data_t stroke;
+	int contours;
+	int element;
+	int nelement;
+	int point;
+	int npoint;
+	SW_FT_Outline * outline;
+	SW_FT_Polygon * polygon;
+	int x1, y1;
+	int x2, y2;
+};
+
+struct cg_display_list_t {
+	struct {
+		struct cg_command_t * data;
+		int size;
+		int capacity;
+	} commands;
+	struct {
+		enum cg_path_element_t * data;
+		int size;
+		int capacity;
+	} elements;
+	struct {
+		struct cg_point_t * data;
+		int size;
+		int capacity;
+	} points;
+	struct {
+		struct cg_dash_t ** data;
+		int size;
+		int capacity;
+	} dashes;
+	struct cg_paint_t * paint;
+	int prepared;
+};
+
+static struct cg_display_list_t * cg_display_list_create(void)
+{
+	struct cg_display_list_t * list = malloc(sizeof(struct cg_display_list_t));
+	cg_array_init(list->commands);
+	cg_array_init(list->elements);
+	cg_array_init(list->points);
+	cg_array_init(list->dashes);
+	list->paint = NULL;
+	list->prepared = 0;
+	return list;
+}
+
+static struct cg_command_t * cg_display_list_add(struct cg_display_list_t * list, enum cg_command_type_t type)
+{
+	cg_array_ensure(list->commands, 1);
+	struct cg_command_t * cmd = list->commands.data + list->commands.size;
+	list->commands.size += 1;
+	memset(cmd, 0, sizeof(struct cg_command_t));
+	cmd->type = type;
+	cmd->x1 = INT_MIN;
+	cmd->y1 = INT_MIN;
+	cmd->x2 = INT_MAX;
+	cmd->y2 = INT_MAX;
+	list->prepared = 0;
+	return cmd;
+}
+
+static void cg_display_list_add_path(struct cg_display_list_t * list, struct cg_command_t * cmd, struct cg_state_t * state, struct cg_path_t * path)
+{
+	cmd->winding = state->winding;
+	cmd->antialias = state->antialias;
+	cmd->tolerance = state->tolerance;
+	cmd->matrix = state->matrix;
+	cmd->contours = path->contours;
+	cmd->element = list->elements.size;
+	cmd->nelement = path->elements.size;
+	cmd->point = list->points.size;
+	cmd->npoint = path->points.size;
+	cg_array_ensure(list->elements, path->elements.size);
+	memcpy(list->elements.data + list->elements.size, path->elements.data, (size_t)path->elements.size * sizeof(enum cg_path_element_t));
+	list->elements.size += path->elements.size;
+	cg_array_ensure(list->points, path->points.size);
+	memcpy(list->points.data + list->points.size, path->points.data, (size_t)path->points.size * sizeof(struct cg_point_t));
+	list->points.size += path->points.size;
+}
+
+static int cg_paint_equal(struct cg_paint_t * a, struct cg_paint_t * b)
+{
+	if(a->type != b->type)
+		return 0;
+	switch(a->type)
+	{
+	case CG_PAINT_TYPE_COLOR:
+		return !memcmp(a->color, b->color, sizeof(struct cg_color_t));
+	case CG_PAINT_TYPE_GRADIENT:
+		return (a->gradient->type == b->gradient->type) && (a->gradient->spread == b->gradient->spread) && (a->gradient->opacity == b->gradient->opacity)
+			&& !memcmp(&a->gradient->matrix, &b->gradient->matrix, sizeof(struct cg_matrix_t))
+			&& !memcmp(a->gradient->values, b->gradient->values, sizeof(a->gradient->values))
+			&& (a->gradient->stops.size == b->gradient->stops.size)
+			&& !memcmp(a->gradient->stops.data, b->gradient->stops.data, (size_t)a->gradient->stops.size * sizeof(struct cg_gradient_stop_t));
+	case CG_PAINT_TYPE_TEXTURE:
+		return (a->texture->type == b->texture->type) && (a->texture->filter == b->texture->filter) && (a->texture->mipmap == b->texture->mipmap) && (a->texture->surface == b->texture->surface) && (a->texture->opacity == b->texture->opacity)
+			&& !memcmp(&a->texture->matrix, &b->texture->matrix, sizeof(struct cg_matrix_t));
+	default:
+		break;
+	}
+	return 0;
+}
+
+static struct cg_paint_t * cg_paint_snapshot(struct cg_paint_t * paint)
+{
+	struct cg_paint_t * result = NULL;
+	switch(paint->type)
+	{
+	case CG_PAINT_TYPE_COLOR:
+		result = cg_paint_create_color(paint->color);
+		break;
+	case CG_PAINT_TYPE_GRADIENT:
+		{
+			struct cg_gradient_t * gradient = malloc(sizeof(struct cg_gradient_t));
+			memcpy(gradient, paint->gradient, sizeof(struct cg_gradient_t));
+			gradient->ref = 1;
+			gradient->colortable = NULL;
+			gradient->colortable_opacity = -1.0;
+			cg_array_init(gradient->stops);
+			cg_array_ensure(gradient->stops, paint->gradient->stops.size);
+			memcpy(gradient->stops.data, paint->gradient->stops.data, (size_t)paint->gradient->stops.size * sizeof(struct cg_gradient_stop_t));
+			gradient->stops.size = paint->gradient->stops.size;
+			result = cg_paint_create_gradient(gradient);
+			cg_gradient_destroy(gradient);
+		}
+		break;
+	case CG_PAINT_TYPE_TEXTURE:
+		{
+			struct cg_texture_t * texture = cg_texture_create(paint->texture->surface);
+			texture->type = paint->texture->type;
+			texture->filter = paint->texture->filter;
+			texture->mipmap = paint->texture->mipmap;
+			texture->generation = paint->texture->generation;
+			if(paint->texture->nlevel > 0)
+			{
+				texture->levels = malloc((size_t)paint->texture->nlevel * sizeof(struct cg_surface_t *));
+				for(int i = 0; i < paint->texture->nlevel; i++)
+					texture->levels[i] = cg_surface_reference(paint->texture->levels[i]);
+				texture->nlevel = paint->texture->nlevel;
+			}
+			texture->matrix = paint->texture->matrix;
+			texture->opacity = paint->texture->opacity;
+			result = cg_paint_create_texture(texture);
+			cg_texture_destroy(texture);
+		}
+		break;
+	default:
+		break;
+	}
+	return result;
+}
+
+static void cg_display_list_add_paint(struct cg_display_list_t * list, struct cg_command_t * cmd, struct cg_state_t * state)
+{
+	if(!list->paint || !cg_paint_equal(list->paint, state->source))
+	{
+		if(state->source->type == CG_PAINT_TYPE_TEXTURE)
+			cg_texture_update(state->source->texture, &state->matrix);
+		list->paint = cg_paint_snapshot(state->source);
+	}
+	else
+		cg_paint_reference(list->paint);
+	cmd->paint = list->paint;
+	cmd->op = state->op;
+	cmd->opacity = state->opacity;
+	cmd->matrix = state->matrix;
+}
+
+static void cg_display_list_add_stroke(struct cg_display_list_t * list, struct cg_command_t * cmd, struct cg_state_t * state)
+{
+	struct cg_dash_t * dash = state->stroke.dash;
+	cmd->stroke = state->stroke;
+	if(dash)
+	{
+		struct cg_dash_t * last = (list->dashes.size > 0) ? list->dashes.data[list->dashes.size - 1] : NULL;
+		if(!last || (last->size != dash->size) || (last->offset != dash->offset) || memcmp(last->data, dash->data, (size_t)dash->size * sizeof(double)))
+		{
+			cg_array_ensure(list->dashes, 1);
+			last = cg_dash_reference(dash);
+			list->dashes.data[list->dashes.size++] = last;
+		}
+		cmd->stroke.dash = last;
+	}
+}
+
+static inline void cg_display_list_path(struct cg_display_list_t * list, struct cg_command_t * cmd, struct cg_path_t * path)
+{
+	path->ref = 1;
+	path->contours = cmd->contours;
+	path->start.x = 0;
+	path->start.y = 0;
+	path->elements.data = list->elements.data + cmd->element;
+	path->elements.size = cmd->nelement;
+	path->elements.capacity = cmd->nelement;
+	path->points.data = list->points.data + cmd->point;
+	path->points.size = cmd->npoint;
+	path->points.capacity = cmd->npoint;
+}
+
+static void cg_display_list_prepare_command(struct cg_display_list_t * list, struct cg_command_t * cmd, struct cg_scratch_t * scratch)
+{
+	struct cg_path_t path;
+	cg_display_list_path(list, cmd, &path);
+	if((cmd->type == CG_COMMAND_STROKE) && (cmd->antialias != CG_ANTIALIAS_NONE) && cg_stroke_is_hairline(&cmd->stroke, &cmd->matrix))
+	{
+		double x1 = INFINITY, y1 = INFINITY;
+		double x2 = -INFINITY, y2 = -INFINITY;
+		struct cg_point_t p;
+		for(int i = 0; i < path.points.size; i++)
+		{
+			cg_matrix_map_point(&cmd->matrix, &path.points.data[i], &p);
+			x1 = fmin(x1, p.x);
+			y1 = fmin(y1, p.y);
+			x2 = fmax(x2, p.x);
+			y2 = fmax(y2, p.y);
+		}
+		if(path.points.size > 0)
+		{
+			cmd->x1 = (int)CG_CLAMP(floor(x1) - 2.0, (double)INT_MIN, (double)INT_MAX);
+			cmd->y1 = (int)CG_CLAMP(floor(y1) - 2.0, (double)INT_MIN, (double)INT_MAX);
+			cmd->x2 = (int)CG_CLAMP(ceil(x2) + 2.0, (double)INT_MIN, (double)INT_MAX);
+			cmd->y2 = (int)CG_CLAMP(ceil(y2) + 2.0, (double)INT_MIN, (double)INT_MAX);
+		}
+		else
+		{
+			cmd->x1 = 0;
+			cmd->y1 = 0;
+			cmd->x2 = 0;
+			cmd->y2 = 0;
+		}
+		return;
+	}
+	SW_FT_BBox cbox;
+	int dir;
+	SW_FT_Polygon * polygon = NULL;
+	if((cmd->type != CG_COMMAND_STROKE) && !cg_path_is_rectangle(&path, &cmd->matrix, &cbox, &dir))
+		polygon = sw_ft_polygon_generate(scratch, &path, &cmd->matrix, cmd->winding);
+	if(polygon)
+	{
+		cmd->polygon = sw_ft_polygon_copy(cmd->polygon, polygon);
+		SW_FT_Polygon_Get_CBox(cmd->polygon, &cbox);
+	}
+	else
+	{
+		cmd->outline = sw_ft_outline_copy(cmd->outline, sw_ft_outline_generate(scratch, &path, &cmd->matrix, (cmd->type == CG_COMMAND_STROKE) ? &cmd->stroke : NULL, cmd->winding, cmd->tolerance));
+		SW_FT_Outline_Get_CBox(cmd->outline, &cbox);
+	}
+	cmd->x1 = (int)(cbox.xMin >> 6);
+	cmd->y1 = (int)(cbox.yMin >> 6);
+	cmd->x2 = (int)((cbox.xMax + 63) >> 6);
+	cmd->y2 = (int)((cbox.yMax + 63) >> 6);
+}
+
+static inline const void * cg_command_source(struct cg_command_t * cmd, int * flags)
+{
+	if(cmd->polygon)
+	{
+		*flags = SW_FT_RASTER_FLAG_POLYGON;
+		return cmd->polygon;
+	}
+	*flags = 0;
+	return cmd->outline;
+}
+
+struct cg_replay_task_t {
+	struct cg_ctx_t * ctx;
+	struct cg_display_list_t * list;
+	int y;
+	int h;
+	int count;
+};
+
+static void cg_display_list_prepare_range(void * data, int index, int slot)
+{
+	struct cg_replay_task_t * task = data;
+	struct cg_display_list_t * list = task->list;
+	struct cg_scratch_t * scratch = task->ctx->pool ? task->ctx->pool->scratches[slot] : task->ctx->scratch;
+	int i = list->commands.size * index / task->count;
+	int j = list->commands.size * (index + 1) / task->count;
+	for(; i < j; i++)
+	{
+		struct cg_command_t * cmd = list->commands.data + i;
+		if((cmd->type == CG_COMMAND_CLIP) || (cmd->type == CG_COMMAND_FILL) || (cmd->type == CG_COMMAND_STROKE))
+			cg_display_list_prepare_command(list, cmd, scratch);
+	}
+}
+
+static void cg_display_list_render_tile(void * data, int index, int slot)
+{
+	struct cg_replay_task_t * task = data;
+	struct cg_ctx_t * ctx = task->ctx;
+	struct cg_display_list_t * list = task->list;
+	int y1 = task->y + CG_TILE_HEIGHT * index;
+	int y2 = (task->count == 1) ? task->y + task->h : CG_MIN(y1 + CG_TILE_HEIGHT, task->y + task->h);
+	int x1 = (int)ctx->clip.x;
+	int x2 = (int)(ctx->clip.x + ctx->clip.w);
+
+	struct cg_rle_t * base = NULL;
+	if(ctx->state->clippath)
+	{
+		struct cg_rle_t slice;
+		cg_rle_slice(&slice, ctx->state->clippath, y1, y2);
+		base = cg_rle_clone(&slice);
+	}
+	struct cg_state_t state;
+	memset(&state, 0, sizeof(struct cg_state_t));
+	state.clippath = cg_rle_reference(base);
+	state.source = NULL;
+	state.antialias = CG_ANTIALIAS_DEFAULT;
+	state.next = NULL;
+	struct cg_ctx_t tile;
+	memset(&tile, 0, sizeof(struct cg_ctx_t));
+	tile.surface = ctx->surface;
+	tile.state = &state;
+	tile.path = NULL;
+	tile.rle = ctx->pool ? ctx->pool->rles[slot] : ctx->rle;
+	tile.raster = ctx->pool ? ctx->pool->rasters[slot] : ctx->raster;
+	tile.rasterizer = ctx->rasterizer;
+	tile.scratch = ctx->pool ? ctx->pool->scratches[slot] : ctx->scratch;
+	tile.clippath = NULL;
+	cg_rect_init(&tile.clip, ctx->clip.x, y1, ctx->clip.w, y2 - y1);
+	tile.pool = NULL;
+	tile.record = NULL;
+	struct {
+		struct cg_rle_t ** data;
+		int size;
+		int capacity;
+	} stack;
+	cg_array_init(stack);
+	const void * source;
+	int flags;
+
+	for(int i = 0; i < list->commands.size; i++)
+	{
+		struct cg_command_t * cmd = list->commands.data + i;
+		int visible = (cmd->x1 < x2) && (cmd->x2 > x1) && (cmd->y1 < y2) && (cmd->y2 > y1);
+		switch(cmd->type)
+		{
+		case CG_COMMAND_SAVE:
+			cg_array_ensure(stack, 1);
+			stack.data[stack.size++] = cg_rle_reference(state.clippath);
+			break;
+		case CG_COMMAND_RESTORE:
+			if(stack.size > 0)
+			{
+				cg_rle_destroy(state.clippath);
+				state.clippath = stack.data[--stack.size];
+			}
+			break;
+		case CG_COMMAND_RESET_CLIP:
+			cg_rle_destroy(state.clippath);
+			state.clippath = cg_rle_reference(base);
+			break;
+		case CG_COMMAND_CLIP:
+			state.antialias = cmd->antialias;
+			source = cg_command_source(cmd, &flags);
+			if(state.clippath)
+			{
+				cg_rle_clear(tile.rle);
+				if(visible)
+					cg_rle_rasterize_source(tile.rle, tile.raster, source, flags | cg_raster_flags(&tile), &tile.clip);
+				state.clippath = cg_rle_clip(state.clippath, tile.rle, tile.scratch->rle);
+			}
+			else
+			{
+				state.clippath = cg_rle_create();
+				if(visible)
+					cg_rle_rasterize_source(state.clippath, tile.raster, source, flags | cg_raster_flags(&tile), &tile.clip);
+			}
+			break;
+		case CG_COMMAND_FILL:
+		case CG_COMMAND_STROKE:
+		case CG_COMMAND_PAINT:
+			if(visible && !(state.clippath && (state.clippath->spans.size == 0)))
+			{
+				state.source = cmd->paint;
+				state.antialias = cmd->antialias;
+				state.matrix = cmd->matrix;
+				state.op = cmd->op;
+				state.opacity = cmd->opacity;
+				if(cmd->type == CG_COMMAND_PAINT)
+				{
+					cg_render_paint(&tile);
+				}
+				else if(cmd->outline || cmd->polygon)
+				{
+					source = cg_command_source(cmd, &flags);
+					cg_render_source(&tile, source, flags);
+				}
+				else
+				{
+					struct cg_path_t path;
+					cg_display_list_path(list, cmd, &path);
+					cg_rle_clear(tile.rle);
+					cg_rle_rasterize_hairline(tile.rle, tile.scratch, &path, &cmd->matrix, &tile.clip, &cmd->stroke, cmd->tolerance);
+					cg_rle_intersect(tile.rle, state.clippath, tile.scratch->rle);
+					cg_render_rle(&tile, tile.rle);
+				}
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	while(stack.size > 0)
+		cg_rle_destroy(stack.data[--stack.size]);
+	free(stack.data);
+	cg_rle_destroy(state.clippath);
+	cg_rle_destroy(base);
+	cg_rle_destroy(tile.clippath);
+}
+
 struct cg_ctx_t * cg_create(struct cg_surface_t * surface)
 {
 	struct cg_ctx_t * ctx = malloc(sizeof(struct cg_ctx_t));
+	cg_comp_init();
 	ctx->surface = cg_surface_reference(surface);
 	ctx->state = cg_state_create();
 	ctx->path = cg_path_create();
 	ctx->rle = cg_rle_create();
 	ctx->clippath = NULL;
 	cg_rect_init(&ctx->clip, 0, 0, surface->width, surface->height);
+	ctx->state->clip = ctx->clip;
+	ctx->raster = NULL;
+	sw_ft_grays_raster.raster_new(&ctx->raster);
+	ctx->rasterizer = CG_RASTERIZER_CELL;
+	ctx->scratch = cg_scratch_create();
+	ctx->pool = NULL;
+	ctx->record = NULL;
 	return ctx;
 }
 
@@ -2286,22 +6042,44 @@ void cg_destroy(struct cg_ctx_t * ctx)
 		cg_path_destroy(ctx->path);
 		cg_rle_destroy(ctx->rle);
 		cg_rle_destroy(ctx->clippath);
+		sw_ft_grays_raster.raster_done(ctx->raster);
+		cg_scratch_destroy(ctx->scratch);
+		cg_pool_destroy(ctx->pool);
+		cg_display_list_destroy(ctx->record);
 		free(ctx);
 	}
 }
 
+void cg_set_threads(struct cg_ctx_t * ctx, int threads)
+{
+	if(ctx->pool && (ctx->pool->nslot == threads))
+		return;
+	cg_pool_destroy(ctx->pool);
+	ctx->pool = (threads > 1) ? cg_pool_create(threads) : NULL;
+}
+
+void cg_set_rasterizer(struct cg_ctx_t * ctx, enum cg_rasterizer_t rasterizer)
+{
+	ctx->rasterizer = rasterizer;
+}
+
 void cg_save(struct cg_ctx_t * ctx)
 {
 	struct cg_state_t * state = cg_state_clone(ctx->state);
 	state->next = ctx->state;
 	ctx->state = state;
+	if(ctx->record)
+		cg_display_list_add(ctx->record, CG_COMMAND_SAVE);
 }
 
 void cg_restore(struct cg_ctx_t * ctx)
 {
 	struct cg_state_t * state = ctx->state;
 	ctx->state = state->next;
+	ctx->clip = ctx->state->clip;
 	cg_state_destroy(state);
+	if(ctx->record)
+		cg_display_list_add(ctx->record, CG_COMMAND_RESTORE);
 }
 
 void cg_set_source_rgb(struct cg_ctx_t * ctx, double r, double g, double b)
@@ -2368,6 +6146,11 @@ void cg_set_fill_rule(struct cg_ctx_t * ctx, enum cg_fill_rule_t winding)
 	ctx->state->winding = winding;
 }
 
+void cg_set_antialias(struct cg_ctx_t * ctx, enum cg_antialias_t antialias)
+{
+	ctx->state->antialias = antialias;
+}
+
 void cg_set_line_width(struct cg_ctx_t * ctx, double width)
 {
 	ctx->state->stroke.width = width;
@@ -2388,6 +6171,13 @@ void cg_set_miter_limit(struct cg_ctx_t * ctx, double limit)
 	ctx->state->stroke.miterlimit = limit;
 }
 
+void cg_set_tolerance(struct cg_ctx_t * ctx, double tolerance)
+{
+	if(!(tolerance > 0.001))
+		tolerance = 0.001;
+	ctx->state->tolerance = tolerance;
+}
+
 void cg_set_dash(struct cg_ctx_t * ctx, double * dashes, int ndash, double offset)
 {
 	cg_dash_destroy(ctx->state->stroke.dash);
@@ -2506,8 +6296,38 @@ void cg_close_path(struct cg_ctx_t * ctx)
 
 void cg_reset_clip(struct cg_ctx_t * ctx)
 {
+	if(ctx->record)
+	{
+		cg_display_list_add(ctx->record, CG_COMMAND_RESET_CLIP);
+		return;
+	}
 	cg_rle_destroy(ctx->state->clippath);
 	ctx->state->clippath = NULL;
+	cg_rect_init(&ctx->clip, 0, 0, ctx->surface->width, ctx->surface->height);
+	ctx->state->clip = ctx->clip;
+}
+
+static inline int cg_clip_is_empty(struct cg_ctx_t * ctx)
+{
+	return (ctx->clip.w <= 0) || (ctx->clip.h <= 0);
+}
+
+static int cg_clip_rectangle(struct cg_ctx_t * ctx)
+{
+	struct cg_state_t * state = ctx->state;
+	SW_FT_BBox box;
+	int dir;
+	if(state->clippath || !cg_path_is_rectangle(ctx->path, &state->matrix, &box, &dir))
+		return 0;
+	if((box.xMin | box.yMin | box.xMax | box.yMax) & 63)
+		return 0;
+	SW_FT_Pos x1 = CG_MAX(box.xMin >> 6, (SW_FT_Pos)ctx->clip.x);
+	SW_FT_Pos y1 = CG_MAX(box.yMin >> 6, (SW_FT_Pos)ctx->clip.y);
+	SW_FT_Pos x2 = CG_MIN(box.xMax >> 6, (SW_FT_Pos)(ctx->clip.x + ctx->clip.w));
+	SW_FT_Pos y2 = CG_MIN(box.yMax >> 6, (SW_FT_Pos)(ctx->clip.y + ctx->clip.h));
+	cg_rect_init(&ctx->clip, x1, y1, CG_MAX(x2 - x1, (SW_FT_Pos)0), CG_MAX(y2 - y1, (SW_FT_Pos)0));
+	state->clip = ctx->clip;
+	return 1;
 }
 
 void cg_clip(struct cg_ctx_t * ctx)
@@ -2519,16 +6339,24 @@ void cg_clip(struct cg_ctx_t * ctx)
 void cg_clip_preserve(struct cg_ctx_t * ctx)
 {
 	struct cg_state_t * state = ctx->state;
+	if(ctx->record)
+	{
+		struct cg_command_t * cmd = cg_display_list_add(ctx->record, CG_COMMAND_CLIP);
+		cg_display_list_add_path(ctx->record, cmd, state, ctx->path);
+		return;
+	}
+	if(cg_clip_is_empty(ctx) || cg_clip_rectangle(ctx))
+		return;
 	if(state->clippath)
 	{
 		cg_rle_clear(ctx->rle);
-		cg_rle_rasterize(ctx->rle, ctx->path, &state->matrix, &ctx->clip, NULL, state->winding);
-		cg_rle_intersect(state->clippath, ctx->rle);
+		cg_rle_rasterize(ctx->rle, ctx->raster, cg_raster_flags(ctx), ctx->scratch, ctx->path, &state->matrix, &ctx->clip, NULL, state->winding, state->tolerance);
+		state->clippath = cg_rle_clip(state->clippath, ctx->rle, ctx->scratch->rle);
 	}
 	else
 	{
 		state->clippath = cg_rle_create();
-		cg_rle_rasterize(state->clippath, ctx->path, &state->matrix, &ctx->clip, NULL, state->winding);
+		cg_rle_rasterize(state->clippath, ctx->raster, cg_raster_flags(ctx), ctx->scratch, ctx->path, &state->matrix, &ctx->clip, NULL, state->winding, state->tolerance);
 	}
 }
 
@@ -2541,10 +6369,32 @@ void cg_fill(struct cg_ctx_t * ctx)
 void cg_fill_preserve(struct cg_ctx_t * ctx)
 {
 	struct cg_state_t * state = ctx->state;
+	if(ctx->record)
+	{
+		struct cg_command_t * cmd = cg_display_list_add(ctx->record, CG_COMMAND_FILL);
+		cg_display_list_add_path(ctx->record, cmd, state, ctx->path);
+		cg_display_list_add_paint(ctx->record, cmd, state);
+		return;
+	}
+	if(cg_clip_is_empty(ctx))
+		return;
+	cg_source_update(ctx);
+	cg_surface_mark_dirty(ctx->surface);
 	cg_rle_clear(ctx->rle);
-	cg_rle_rasterize(ctx->rle, ctx->path, &state->matrix, &ctx->clip, NULL, state->winding);
-	cg_rle_intersect(ctx->rle, state->clippath);
-	cg_blend(ctx, ctx->rle);
+	if(cg_rle_rasterize_rectangle(ctx->rle, ctx->path, &state->matrix, &ctx->clip, cg_raster_flags(ctx)))
+	{
+		cg_rle_intersect(ctx->rle, state->clippath, ctx->scratch->rle);
+		cg_render_rle(ctx, ctx->rle);
+		return;
+	}
+	SW_FT_Polygon * polygon = sw_ft_polygon_generate(ctx->scratch, ctx->path, &state->matrix, state->winding);
+	if(polygon)
+	{
+		cg_render_source(ctx, polygon, SW_FT_RASTER_FLAG_POLYGON);
+		return;
+	}
+	SW_FT_Outline * outline = sw_ft_outline_generate(ctx->scratch, ctx->path, &state->matrix, NULL, state->winding, state->tolerance);
+	cg_render_source(ctx, outline, 0);
 }
 
 void cg_stroke(struct cg_ctx_t * ctx)
@@ -2556,25 +6406,125 @@ void cg_stroke(struct cg_ctx_t * ctx)
 void cg_stroke_preserve(struct cg_ctx_t * ctx)
 {
 	struct cg_state_t * state = ctx->state;
+	if(ctx->record)
+	{
+		struct cg_command_t * cmd = cg_display_list_add(ctx->record, CG_COMMAND_STROKE);
+		cg_display_list_add_path(ctx->record, cmd, state, ctx->path);
+		cg_display_list_add_paint(ctx->record, cmd, state);
+		cg_display_list_add_stroke(ctx->record, cmd, state);
+		return;
+	}
+	if(cg_clip_is_empty(ctx))
+		return;
+	cg_source_update(ctx);
+	cg_surface_mark_dirty(ctx->surface);
 	cg_rle_clear(ctx->rle);
-	cg_rle_rasterize(ctx->rle, ctx->path, &state->matrix, &ctx->clip, &state->stroke, CG_FILL_RULE_NON_ZERO);
-	cg_rle_intersect(ctx->rle, state->clippath);
-	cg_blend(ctx, ctx->rle);
+	if((state->antialias != CG_ANTIALIAS_NONE) && cg_rle_rasterize_hairline(ctx->rle, ctx->scratch, ctx->path, &state->matrix, &ctx->clip, &state->stroke, state->tolerance))
+	{
+		cg_rle_intersect(ctx->rle, state->clippath, ctx->scratch->rle);
+		cg_render_rle(ctx, ctx->rle);
+		return;
+	}
+	SW_FT_UInt points;
+	SW_FT_UInt contours;
+	SW_FT_Stroker stroker = sw_ft_stroker_parse(ctx->scratch, ctx->path, &state->matrix, &state->stroke, state->tolerance, &points, &contours);
+	if(contours > 0)
+		cg_render_source(ctx, stroker, SW_FT_RASTER_FLAG_STROKER);
+	SW_FT_Stroker_Rewind(stroker);
 }
 
 void cg_paint(struct cg_ctx_t * ctx)
 {
 	struct cg_state_t * state = ctx->state;
-	if((state->clippath == NULL) && (ctx->clippath == NULL))
+	if(ctx->record)
 	{
-		struct cg_path_t * path = cg_path_create();
-		cg_path_add_rectangle(path, ctx->clip.x, ctx->clip.y, ctx->clip.w, ctx->clip.h);
-		struct cg_matrix_t m;
-		cg_matrix_init_identity(&m);
-		ctx->clippath = cg_rle_create();
-		cg_rle_rasterize(ctx->clippath, path, &m, &ctx->clip, NULL, CG_FILL_RULE_NON_ZERO);
-		cg_path_destroy(path);
+		struct cg_command_t * cmd = cg_display_list_add(ctx->record, CG_COMMAND_PAINT);
+		cg_display_list_add_paint(ctx->record, cmd, state);
+		return;
+	}
+	if(cg_clip_is_empty(ctx))
+		return;
+	cg_source_update(ctx);
+	cg_surface_mark_dirty(ctx->surface);
+	cg_render_paint(ctx);
+}
+
+void cg_begin_recording(struct cg_ctx_t * ctx)
+{
+	cg_display_list_destroy(ctx->record);
+	ctx->record = cg_display_list_create();
+}
+
+struct cg_display_list_t * cg_end_recording(struct cg_ctx_t * ctx)
+{
+	struct cg_display_list_t * list = ctx->record;
+	ctx->record = NULL;
+	return list;
+}
+
+void cg_display_list_destroy(struct cg_display_list_t * list)
+{
+	if(list)
+	{
+		for(int i = 0; i < list->commands.size; i++)
+		{
+			struct cg_command_t * cmd = list->commands.data + i;
+			cg_paint_destroy(cmd->paint);
+			sw_ft_outline_destroy(cmd->outline);
+			sw_ft_polygon_destroy(cmd->polygon);
+		}
+		for(int i = 0; i < list->dashes.size; i++)
+			cg_dash_destroy(list->dashes.data[i]);
+		free(list->commands.data);
+		free(list->elements.data);
+		free(list->points.data);
+		free(list->dashes.data);
+		free(list);
+	}
+}
+
+void cg_display_list_replay(struct cg_ctx_t * ctx, struct cg_display_list_t * list)
+{
+	if(!list || (list->commands.size == 0))
+		return;
+	struct cg_replay_task_t task;
+	task.ctx = ctx;
+	task.list = list;
+	if(!list->prepared)
+	{
+		task.count = ctx->pool ? CG_MIN(ctx->pool->nslot, list->commands.size) : 1;
+		if(task.count > 1)
+			cg_pool_run(ctx->pool, task.count, cg_display_list_prepare_range, &task);
+		else
+			cg_display_list_prepare_range(&task, 0, 0);
+		list->prepared = 1;
+	}
+	task.y = (int)ctx->clip.y;
+	task.h = (int)(ctx->clip.y + ctx->clip.h) - task.y;
+	task.count = (task.h + CG_TILE_HEIGHT - 1) / CG_TILE_HEIGHT;
+	for(int i = 0; i < list->commands.size; i++)
+	{
+		struct cg_paint_t * paint = list->commands.data[i].paint;
+		if(paint && (paint->type == CG_PAINT_TYPE_GRADIENT))
+			cg_gradient_update(paint->gradient, list->commands.data[i].opacity * paint->gradient->opacity);
+		else if(paint && (paint->type == CG_PAINT_TYPE_TEXTURE))
+			cg_texture_update(paint->texture, &list->commands.data[i].matrix);
+	}
+	for(int i = 0; i < list->commands.size; i++)
+	{
+		struct cg_paint_t * paint = list->commands.data[i].paint;
+		if(paint && (paint->type == CG_PAINT_TYPE_TEXTURE) && paint->texture && (paint->texture->surface == ctx->surface))
+		{
+			task.count = 1;
+			break;
+		}
+	}
+	cg_surface_mark_dirty(ctx->surface);
+	if(ctx->pool && (task.count > 1))
+		cg_pool_run(ctx->pool, task.count, cg_display_list_render_tile, &task);
+	else
+	{
+		for(int i = 0; i < task.count; i++)
+			cg_display_list_render_tile(&task, i, 0);
 	}
-	struct cg_rle_t * rle = state->clippath ? state->clippath : ctx->clippath;
-	cg_blend(ctx, rle);
 }
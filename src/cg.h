@@ -60,6 +60,12 @@ enum cg_texture_type_t {
 	CG_TEXTURE_TYPE_TILED		= 1,
 };
 
+enum cg_texture_filter_t {
+	CG_TEXTURE_FILTER_NEAREST	= 0,
+	CG_TEXTURE_FILTER_BILINEAR	= 1,
+	CG_TEXTURE_FILTER_BICUBIC	= 2,
+};
+
 enum cg_line_cap_t {
 	CG_LINE_CAP_BUTT			= 0,
 	CG_LINE_CAP_ROUND			= 1,
@@ -77,6 +83,16 @@ enum cg_fill_rule_t {
 	CG_FILL_RULE_EVEN_ODD		= 1,
 };
 
+enum cg_antialias_t {
+	CG_ANTIALIAS_DEFAULT		= 0,
+	CG_ANTIALIAS_NONE			= 1,
+};
+
+enum cg_rasterizer_t {
+	CG_RASTERIZER_CELL			= 0,
+	CG_RASTERIZER_ACCUMULATE	= 1,
+};
+
 enum cg_paint_type_t {
 	CG_PAINT_TYPE_COLOR			= 0,
 	CG_PAINT_TYPE_GRADIENT		= 1,
@@ -88,6 +104,26 @@ enum cg_operator_t {
 	CG_OPERATOR_SRC_OVER		= 1, /* r = (s + d * sia) * ca + d * cia */
 	CG_OPERATOR_DST_IN			= 2, /* r = d * sa * ca + d * cia */
 	CG_OPERATOR_DST_OUT			= 3, /* r = d * sia * ca + d * cia */
+	CG_OPERATOR_CLEAR			= 4, /* r = d * cia */
+	CG_OPERATOR_DST				= 5, /* r = d */
+	CG_OPERATOR_SRC_IN			= 6, /* r = s * da * ca + d * cia */
+	CG_OPERATOR_SRC_OUT			= 7, /* r = s * dia * ca + d * cia */
+	CG_OPERATOR_SRC_ATOP		= 8, /* r = (s * da + d * sia) * ca + d * cia */
+	CG_OPERATOR_DST_OVER		= 9, /* r = (d + s * dia) * ca + d * cia */
+	CG_OPERATOR_DST_ATOP		= 10, /* r = (d * sa + s * dia) * ca + d * cia */
+	CG_OPERATOR_XOR				= 11, /* r = (s * dia + d * sia) * ca + d * cia */
+	CG_OPERATOR_ADD				= 12, /* r = min(s + d, 1) * ca + d * cia */
+	CG_OPERATOR_MULTIPLY		= 13, /* r = (s * d + s * dia + d * sia) * ca + d * cia */
+	CG_OPERATOR_SCREEN			= 14, /* r = (s + d - s * d) * ca + d * cia */
+	CG_OPERATOR_OVERLAY			= 15, /* r = (hardlight(d, s) + s * dia + d * sia) * ca + d * cia */
+	CG_OPERATOR_DARKEN			= 16, /* r = (min(s * da, d * sa) + s * dia + d * sia) * ca + d * cia */
+	CG_OPERATOR_LIGHTEN			= 17, /* r = (max(s * da, d * sa) + s * dia + d * sia) * ca + d * cia */
+	CG_OPERATOR_COLOR_DODGE		= 18, /* r = (dodge(s, d) + s * dia + d * sia) * ca + d * cia */
+	CG_OPERATOR_COLOR_BURN		= 19, /* r = (burn(s, d) + s * dia + d * sia) * ca + d * cia */
+	CG_OPERATOR_HARD_LIGHT		= 20, /* r = (hardlight(s, d) + s * dia + d * sia) * ca + d * cia */
+	CG_OPERATOR_SOFT_LIGHT		= 21, /* r = (softlight(s, d) + s * dia + d * sia) * ca + d * cia */
+	CG_OPERATOR_DIFFERENCE		= 22, /* r = (s + d - 2 * min(s * da, d * sa)) * ca + d * cia */
+	CG_OPERATOR_EXCLUSION		= 23, /* r = (s + d - 2 * s * d) * ca + d * cia */
 };
 
 struct cg_surface_t {
@@ -97,6 +133,7 @@ struct cg_surface_t {
 	int stride;
 	int owndata;
 	void * pixels;
+	int generation;
 };
 
 struct cg_path_t {
@@ -127,14 +164,21 @@ struct cg_gradient_t {
 		int size;
 		int capacity;
 	} stops;
+	uint32_t * colortable;
+	double colortable_opacity;
 };
 
 struct cg_texture_t {
 	int ref;
 	enum cg_texture_type_t type;
+	enum cg_texture_filter_t filter;
 	struct cg_surface_t * surface;
 	struct cg_matrix_t matrix;
 	double opacity;
+	int mipmap;
+	int generation;
+	int nlevel;
+	struct cg_surface_t ** levels;
 };
 
 struct cg_paint_t {
@@ -148,13 +192,14 @@ struct cg_paint_t {
 };
 
 struct cg_span_t {
-	short x;
-	short y;
-	unsigned short len;
+	int x;
+	int y;
+	int len;
 	unsigned char coverage;
 };
 
 struct cg_rle_t {
+	int ref;
 	struct {
 		struct cg_span_t * data;
 		int size;
@@ -167,6 +212,7 @@ struct cg_rle_t {
 };
 
 struct cg_dash_t {
+	int ref;
 	double offset;
 	double * data;
 	int size;
@@ -182,15 +228,22 @@ struct cg_stroke_data_t {
 
 struct cg_state_t {
 	struct cg_rle_t * clippath;
+	struct cg_rect_t clip;
 	struct cg_paint_t * source;
 	struct cg_matrix_t matrix;
 	enum cg_fill_rule_t winding;
+	enum cg_antialias_t antialias;
 	struct cg_stroke_data_t stroke;
 	enum cg_operator_t op;
 	double opacity;
+	double tolerance;
 	struct cg_state_t * next;
 };
 
+struct cg_pool_t;
+struct cg_scratch_t;
+struct cg_display_list_t;
+
 struct cg_ctx_t {
 	struct cg_surface_t * surface;
 	struct cg_state_t * state;
@@ -198,6 +251,11 @@ struct cg_ctx_t {
 	struct cg_rle_t * rle;
 	struct cg_rle_t * clippath;
 	struct cg_rect_t clip;
+	SW_FT_Raster raster;
+	enum cg_rasterizer_t rasterizer;
+	struct cg_scratch_t * scratch;
+	struct cg_pool_t * pool;
+	struct cg_display_list_t * record;
 };
 
 #ifndef CG_MIN
@@ -245,6 +303,9 @@ struct cg_surface_t * cg_surface_create(int width, int height);
 struct cg_surface_t * cg_surface_create_for_data(int width, int height, void * pixels);
 void cg_surface_destroy(struct cg_surface_t * surface);
 struct cg_surface_t * cg_surface_reference(struct cg_surface_t * surface);
+void cg_surface_mark_dirty(struct cg_surface_t * surface); /* call after writing to surface->pixels directly */
+void cg_surface_convert_from_rgba(struct cg_surface_t * surface, const void * rgba, int stride);
+void cg_surface_convert_to_rgba(struct cg_surface_t * surface, void * rgba, int stride);
 
 struct cg_path_t * cg_path_create(void);
 void cg_path_destroy(struct cg_path_t * path);
@@ -267,6 +328,8 @@ struct cg_texture_t * cg_texture_create(struct cg_surface_t * surface);
 void cg_texture_destroy(struct cg_texture_t * texture);
 struct cg_texture_t * cg_texture_reference(struct cg_texture_t * texture);
 void cg_texture_set_type(struct cg_texture_t * texture, enum cg_texture_type_t type);
+void cg_texture_set_filter(struct cg_texture_t * texture, enum cg_texture_filter_t filter);
+void cg_texture_set_mipmap(struct cg_texture_t * texture, int mipmap);
 void cg_texture_set_matrix(struct cg_texture_t * texture, struct cg_matrix_t * m);
 void cg_texture_set_surface(struct cg_texture_t * texture, struct cg_surface_t * surface);
 void cg_texture_set_opacity(struct cg_texture_t * texture, double opacity);
@@ -288,6 +351,8 @@ struct cg_texture_t * cg_paint_get_texture(struct cg_paint_t * paint);
 
 struct cg_ctx_t * cg_create(struct cg_surface_t * surface);
 void cg_destroy(struct cg_ctx_t * ctx);
+void cg_set_threads(struct cg_ctx_t * ctx, int threads);
+void cg_set_rasterizer(struct cg_ctx_t * ctx, enum cg_rasterizer_t rasterizer);
 void cg_save(struct cg_ctx_t * ctx);
 void cg_restore(struct cg_ctx_t * ctx);
 void cg_set_source_rgb(struct cg_ctx_t * ctx, double r, double g, double b);
@@ -300,10 +365,12 @@ void cg_set_source(struct cg_ctx_t * ctx, struct cg_paint_t * source);
 void cg_set_operator(struct cg_ctx_t * ctx, enum cg_operator_t op);
 void cg_set_opacity(struct cg_ctx_t * ctx, double opacity);
 void cg_set_fill_rule(struct cg_ctx_t * ctx, enum cg_fill_rule_t winding);
+void cg_set_antialias(struct cg_ctx_t * ctx, enum cg_antialias_t antialias);
 void cg_set_line_width(struct cg_ctx_t * ctx, double width);
 void cg_set_line_cap(struct cg_ctx_t * ctx, enum cg_line_cap_t cap);
 void cg_set_line_join(struct cg_ctx_t * ctx, enum cg_line_join_t join);
 void cg_set_miter_limit(struct cg_ctx_t * ctx, double limit);
+void cg_set_tolerance(struct cg_ctx_t * ctx, double tolerance);
 void cg_set_dash(struct cg_ctx_t * ctx, double * dashes, int ndash, double offset);
 void cg_translate(struct cg_ctx_t * ctx, double tx, double ty);
 void cg_scale(struct cg_ctx_t * ctx, double sx, double sy);
@@ -336,6 +403,11 @@ void cg_stroke(struct cg_ctx_t * ctx);
 void cg_stroke_preserve(struct cg_ctx_t * ctx);
 void cg_paint(struct cg_ctx_t * ctx);
 
+void cg_begin_recording(struct cg_ctx_t * ctx);
+struct cg_display_list_t * cg_end_recording(struct cg_ctx_t * ctx);
+void cg_display_list_destroy(struct cg_display_list_t * list);
+void cg_display_list_replay(struct cg_ctx_t * ctx, struct cg_display_list_t * list);
+
 struct cg_surface_t* cg_surface_load_file(const char* path);
 struct cg_surface_t* cg_surface_load_file_crop(const char* path, int crop_w, int crop_h);
 int cg_surface_save_file(struct cg_surface_t* surface,const char* path);
@@ -18,17 +18,7 @@ static struct cg_surface_t* cg__pixel_to_surface(stbi_uc* data,int w,int h) {
 	if (!surface) {
 		return NULL;
 	}
-	for (int i = 0; i < h; ++i) {
-		uint32_t* src = (uint32_t*)data + i * w;
-		uint32_t* dest = (uint32_t*)(surface->pixels + i * surface->stride);
-		for (int j = 0; j < w; ++j) {
-			uint32_t a = (src[j] >> 24) & 0xff;
-			uint32_t b = (((src[j] >> 16) & 0xff) * a) / 255;
-			uint32_t g = (((src[j] >> 8) & 0xff) * a) / 255;
-			uint32_t r = (((src[j] >> 0) & 0xff) * a) / 255;
-			dest[j] = (a << 24) | (r << 16) | (g << 8) | b;
-		}
-	}
+	cg_surface_convert_from_rgba(surface, data, w * 4);
 	return surface;
 }
 
@@ -51,7 +41,7 @@ struct cg_surface_t* cg_surface_load_file(const char* path) {
 }
 
 struct cg_surface_t* cg_surface_load_file_crop(const char* path,int crop_w,int crop_h) {
-	int w, h, channels, nw, nh;
+	int w, h, channels, nw, nh, offset_x, offset_y;
 	uint8_t* scaled_data = NULL;
 	struct cg_surface_t* surface = NULL;
 
@@ -75,12 +65,12 @@ struct cg_surface_t* cg_surface_load_file_crop(const char* path,int crop_w,int c
 	}
 
 	//缩放图片
-	scaled_data = (uint8_t*)stbi_image_malloc(nw * nh * channels);
+	scaled_data = (uint8_t*)malloc((size_t)nw * nh * 4);
 	if (!scaled_data) {
 		goto Error;
 	}
 
-	if (!stbir_resize_uint8(data, w, h, 0, scaled_data, nw, nh, 0, channels)) {
+	if (!stbir_resize_uint8(data, w, h, 0, scaled_data, nw, nh, 0, 4)) {
 		goto Error;
 	}
 
@@ -89,74 +79,30 @@ struct cg_surface_t* cg_surface_load_file_crop(const char* path,int crop_w,int c
 		goto Error;
 	}
 
-	if (nh > crop_h) {
-		//宽度铺满，高度裁剪
-		int offset_y = (nh - crop_h) / 2;
-
-		for (int i = 0; i < crop_h; ++i) {
-			uint32_t* src = (uint32_t*)scaled_data + (i + offset_y) * nw;
-			uint32_t* dest = (uint32_t*)(surface->pixels + i * surface->stride);
-			for (int j = 0; j < crop_w; ++j) {
-				uint32_t a = (src[j] >> 24) & 0xff;
-				uint32_t b = (((src[j] >> 16) & 0xff) * a) / 255;
-				uint32_t g = (((src[j] >> 8) & 0xff) * a) / 255;
-				uint32_t r = (((src[j] >> 0) & 0xff) * a) / 255;
-				dest[j] = (a << 24) | (r << 16) | (g << 8) | b;
-			}
-		}
-
-	} else {
-		int offset_x = (nw - crop_w) / 2;
-
-		for (int i = 0; i < crop_h; ++i) {
-			uint32_t* src = (uint32_t*)scaled_data + i * nw + offset_x;
-			uint32_t* dest = (uint32_t*)(surface->pixels + i * surface->stride);
-			for (int j = 0; j < crop_w; ++j) {
-				uint32_t a = (src[j] >> 24) & 0xff;
-				uint32_t b = (((src[j] >> 16) & 0xff) * a) / 255;
-				uint32_t g = (((src[j] >> 8) & 0xff) * a) / 255;
-				uint32_t r = (((src[j] >> 0) & 0xff) * a) / 255;
-				dest[j] = (a << 24) | (r << 16) | (g << 8) | b;
-			}
-		}
-	}
+	//宽度铺满时裁剪高度，否则裁剪宽度
+	offset_x = (nw - crop_w) / 2;
+	offset_y = (nh - crop_h) / 2;
+	cg_surface_convert_from_rgba(surface, scaled_data + ((size_t)offset_y * nw + offset_x) * 4, nw * 4);
 
 Error:
 	if(data)
 		stbi_image_free(data);
 	if(scaled_data)
-		stbi_image_free(scaled_data);
+		free(scaled_data);
 	return surface;
 }
 
 
 int cg_surface_save_file(struct cg_surface_t* surface, const char* path) {
 	int rslt = 0;
-	unsigned char* data = surface->pixels;
 	int width = surface->width;
 	int height = surface->height;
-	int stride = surface->stride;
-	unsigned char* image = malloc((size_t)(stride * height));
-	for (int y = 0; y < height; y++)
-	{
-		uint32_t* src = (uint32_t*)(data + stride * y);
-		uint32_t* dst = (uint32_t*)(image + stride * y);
-		for (int x = 0; x < width; x++)
-		{
-			uint32_t a = src[x] >> 24;
-			if (a != 0)
-			{
-				uint32_t r = (((src[x] >> 16) & 0xff) * 255) / a;
-				uint32_t g = (((src[x] >> 8) & 0xff) * 255) / a;
-				uint32_t b = (((src[x] >> 0) & 0xff) * 255) / a;
-				dst[x] = (a << 24) | (b << 16) | (g << 8) | r;
-			}
-			else
-			{
-				dst[x] = 0;
-			}
-		}
+	int stride = width * 4;
+	unsigned char* image = malloc((size_t)stride * height);
+	if (!image) {
+		return 0;
 	}
+	cg_surface_convert_to_rgba(surface, image, stride);
 
 	const char* postfix = strrchr(path, '.');
 	if (postfix) {
@@ -170,7 +116,7 @@ int cg_surface_save_file(struct cg_surface_t* surface, const char* path) {
 			rslt = stbi_write_jpg(path, width, height, 4, image,80);
 		}
 		else if (strcasecmp(postfix, ".tga") == 0) {
-			rslt = stbi_write_tga(path, width, height, 4, image, 80);
+			rslt = stbi_write_tga(path, width, height, 4, image);
 		}
 	} else {
 		rslt = stbi_write_png(path, width, height, 4, image, 0);
@@ -419,6 +419,8 @@ typedef ptrdiff_t SW_FT_PtrDist;
 #define SW_FT_UNUSED(x) (x) = (x)
 #define SW_FT_THROW(e) SW_FT_ERR_CAT(ErrRaster_, e)
 #define SW_FT_RENDER_POOL_SIZE 16384L
+#define SW_FT_RENDER_POOL_MAX	(64L * 1024L * 1024L)
+#define SW_FT_ACCUM_POOL_SIZE	(8L * 1024L * 1024L)
 
 typedef int (*SW_FT_Outline_MoveToFunc)(const SW_FT_Vector* to, void* user);
 #define SW_FT_Outline_MoveTo_Func SW_FT_Outline_MoveToFunc
@@ -519,11 +521,7 @@ typedef long TPos;
 #if PIXEL_BITS <= 7
 typedef int TArea;
 #else
-#if SW_FT_UINT_MAX == 0xFFFFU
-typedef long Area;
-#else
-typedef int TArea;
-#endif
+typedef long TArea;
 #endif
 
 #define SW_FT_MAX_GRAY_SPANS	256
@@ -536,6 +534,18 @@ typedef struct TCell_ {
 	PCell next;
 } TCell;
 
+typedef struct TEdge_ {
+	double x;
+	double dxdy;
+	TCoord y1, y2;
+	int dir;
+} TEdge;
+
+typedef struct TAccum_ {
+	int cover;
+	int area;
+} TAccum;
+
 typedef struct gray_TWorker_ {
 	TCoord ex, ey;
 	TPos min_ex, max_ex;
@@ -551,6 +561,8 @@ typedef struct gray_TWorker_ {
 	SW_FT_Vector bez_stack[32 * 3 + 1];
 	int lev_stack[32];
 	SW_FT_Outline outline;
+	SW_FT_Stroker stroker;
+	const SW_FT_Polygon *polygon;
 	SW_FT_BBox clip_box;
 	int bound_left;
 	int bound_top;
@@ -567,6 +579,15 @@ typedef struct gray_TWorker_ {
 	long buffer_size;
 	PCell *ycells;
 	TPos ycount;
+	TAccum *accum;
+	TPos *accum_span;
+	TPos accum_pitch;
+	int accumulate;
+	TEdge *edges;
+	SW_FT_PtrDist max_edges;
+	SW_FT_PtrDist num_edges;
+	int mono;
+	struct gray_TRaster_ *raster;
 } gray_TWorker, *gray_PWorker;
 
 #ifndef SW_FT_STATIC_RASTER
@@ -577,6 +598,8 @@ static gray_TWorker ras;
 
 typedef struct gray_TRaster_ {
 	void * memory;
+	void * buffer;
+	long buffer_size;
 } gray_TRaster, *gray_PRaster;
 
 static void gray_init_cells(RAS_ARG_ void* buffer, long byte_size)
@@ -585,6 +608,9 @@ static void gray_init_cells(RAS_ARG_ void* buffer, long byte_size)
 	ras.buffer_size = byte_size;
 	ras.ycells = (PCell*)buffer;
 	ras.cells = NULL;
+	ras.accum = NULL;
+	ras.accum_span = NULL;
+	ras.edges = NULL;
 	ras.max_cells = 0;
 	ras.num_cells = 0;
 	ras.area = 0;
@@ -598,74 +624,186 @@ static void gray_init_cells(RAS_ARG_ void* buffer, long byte_size)
 
 static void gray_compute_cbox(RAS_ARG)
 {
-	SW_FT_Outline *outline = &ras.outline;
-	SW_FT_Vector *vec = outline->points;
-	SW_FT_Vector *limit = vec + outline->n_points;
+	SW_FT_BBox cbox;
+
+	if(ras.stroker)
+		SW_FT_Stroker_GetCBox(ras.stroker, &cbox);
+	else if(ras.polygon)
+		SW_FT_Polygon_Get_CBox(ras.polygon, &cbox);
+	else
+		SW_FT_Outline_Get_CBox(&ras.outline, &cbox);
+	ras.min_ex = cbox.xMin >> 6;
+	ras.min_ey = cbox.yMin >> 6;
+	ras.max_ex = (cbox.xMax + 63) >> 6;
+	ras.max_ey = (cbox.yMax + 63) >> 6;
+}
+
+static int gray_raster_reserve(RAS_ARG_ long size)
+{
+	gray_PRaster raster = ras.raster;
+	if(size <= raster->buffer_size)
+		return 1;
+	if(size > SW_FT_RENDER_POOL_MAX)
+		return 0;
+	void * buffer = realloc(raster->buffer, (size_t)size);
+	if(!buffer)
+		return 0;
+	raster->buffer = buffer;
+	raster->buffer_size = size;
+	ras.buffer = buffer;
+	ras.buffer_size = size;
+	return 1;
+}
+
+static int gray_raster_grow(RAS_ARG)
+{
+	gray_PRaster raster = ras.raster;
+	long size = raster->buffer_size * 2;
+	if(size > SW_FT_RENDER_POOL_MAX)
+		return 0;
+	char * buffer = malloc((size_t)size);
+	if(!buffer)
+		return 0;
+	char * old = ras.buffer;
+	PCell * ycells;
+	PCell cells;
+	long cell_end;
+	int i;
 
-	if(outline->n_points <= 0)
+	memcpy(buffer, old, (size_t)((char*)(ras.cells + ras.num_cells) - old));
+	ycells = (PCell*)(buffer + ((char*)ras.ycells - old));
+	cells = (PCell)(buffer + ((char*)ras.cells - old));
+	for(i = 0; i < ras.ycount; i++)
 	{
-		ras.min_ex = ras.max_ex = 0;
-		ras.min_ey = ras.max_ey = 0;
-		return;
+		if(ycells[i])
+			ycells[i] = (PCell)(buffer + ((char*)ycells[i] - old));
 	}
-	ras.min_ex = ras.max_ex = vec->x;
-	ras.min_ey = ras.max_ey = vec->y;
-	vec++;
-	for(; vec < limit; vec++)
+	for(i = 0; i < ras.num_cells; i++)
 	{
-		TPos x = vec->x;
-		TPos y = vec->y;
-		if(x < ras.min_ex)
-			ras.min_ex = x;
-		if(x > ras.max_ex)
-			ras.max_ex = x;
-		if(y < ras.min_ey)
-			ras.min_ey = y;
-		if(y > ras.max_ey)
-			ras.max_ey = y;
+		if(cells[i].next)
+			cells[i].next = (PCell)(buffer + ((char*)cells[i].next - old));
 	}
-	ras.min_ex = ras.min_ex >> 6;
-	ras.min_ey = ras.min_ey >> 6;
-	ras.max_ex = (ras.max_ex + 63) >> 6;
-	ras.max_ey = (ras.max_ey + 63) >> 6;
+	free(old);
+	raster->buffer = buffer;
+	raster->buffer_size = size;
+	ras.buffer = buffer;
+	ras.buffer_size = size;
+	ras.ycells = ycells;
+	ras.cells = cells;
+	cell_end = size - size % (long)sizeof(TCell);
+	ras.max_cells = (PCell)(buffer + cell_end) - cells;
+	return 1;
 }
 
-static PCell gray_find_cell(RAS_ARG)
+static void gray_accum_cell(RAS_ARG)
 {
-	PCell *pcell, cell;
+	TPos * span = ras.accum_span + ras.ey * 2;
+	TAccum * row = ras.accum + ras.ey * ras.accum_pitch + 1;
 	TPos x = ras.ex;
 
-	if(x > ras.count_ex)
-		x = ras.count_ex;
-	pcell = &ras.ycells[ras.ey];
-	for(;;)
+	if(span[0] > span[1])
 	{
-		cell = *pcell;
-		if(cell == NULL || cell->x > x)
-			break;
-		if(cell->x == x)
-			goto Exit;
-		pcell = &cell->next;
-	}
-	if(ras.num_cells >= ras.max_cells)
-		ft_longjmp(ras.jump_buffer, 1);
-	cell = ras.cells + ras.num_cells++;
-	cell->x = x;
-	cell->area = 0;
-	cell->cover = 0;
-	cell->next = *pcell;
-	*pcell = cell;
-Exit:
-	return cell;
+		span[0] = span[1] = x;
+		row[x].cover = 0;
+		row[x].area = 0;
+	}
+	else if(x < span[0])
+	{
+		memset(row + x, 0, sizeof(TAccum) * (size_t)(span[0] - x));
+		span[0] = x;
+	}
+	else if(x > span[1])
+	{
+		memset(row + span[1] + 1, 0, sizeof(TAccum) * (size_t)(x - span[1]));
+		span[1] = x;
+	}
+	row[x].cover += (int)ras.cover;
+	row[x].area += (int)ras.area;
 }
 
 static void gray_record_cell(RAS_ARG)
 {
 	if(ras.area | ras.cover)
 	{
-		PCell cell = gray_find_cell(RAS_VAR);
-		cell->area += ras.area;
-		cell->cover += ras.cover;
+		if(ras.accum)
+		{
+			gray_accum_cell(RAS_VAR);
+			return;
+		}
+		PCell cell = ras.ycells[ras.ey];
+		TPos x = ras.ex;
+
+		if(x > ras.count_ex)
+			x = ras.count_ex;
+		if(cell && cell->x == x)
+		{
+			cell->area += ras.area;
+			cell->cover += ras.cover;
+			return;
+		}
+		if(ras.num_cells >= ras.max_cells)
+		{
+			if(!ras.raster || !gray_raster_grow(RAS_VAR))
+				ft_longjmp(ras.jump_buffer, 1);
+		}
+		cell = ras.cells + ras.num_cells++;
+		cell->x = x;
+		cell->area = ras.area;
+		cell->cover = ras.cover;
+		cell->next = ras.ycells[ras.ey];
+		ras.ycells[ras.ey] = cell;
+	}
+}
+
+static PCell gray_sort_cells(PCell list)
+{
+	PCell p, q, e, tail;
+	int insize, nmerges, psize, qsize, i;
+
+	if(!list || !list->next)
+		return list;
+	for(insize = 1;; insize *= 2)
+	{
+		p = list;
+		list = NULL;
+		tail = NULL;
+		nmerges = 0;
+		while(p)
+		{
+			nmerges++;
+			q = p;
+			psize = 0;
+			for(i = 0; i < insize && q; i++)
+			{
+				psize++;
+				q = q->next;
+			}
+			qsize = insize;
+			while(psize > 0 || (qsize > 0 && q))
+			{
+				if(psize == 0 || (qsize > 0 && q && q->x < p->x))
+				{
+					e = q;
+					q = q->next;
+					qsize--;
+				}
+				else
+				{
+					e = p;
+					p = p->next;
+					psize--;
+				}
+				if(tail)
+					tail->next = e;
+				else
+					list = e;
+				tail = e;
+			}
+			p = q;
+		}
+		tail->next = NULL;
+		if(nmerges <= 1)
+			return list;
 	}
 }
 
@@ -703,11 +841,58 @@ static void gray_start_cell(RAS_ARG_ TCoord ex, TCoord ey)
 	gray_set_cell(RAS_VAR_ ex, ey);
 }
 
+static void gray_add_edge(RAS_ARG_ TPos to_x, TPos to_y)
+{
+	TPos x1 = ras.x, y1 = ras.y;
+	TPos x2 = to_x, y2 = to_y;
+	TCoord ey1, ey2;
+	TEdge * edge;
+	int dir = 1;
+
+	ras.x = to_x;
+	ras.y = to_y;
+	if(y1 == y2)
+		return;
+	if(y1 > y2)
+	{
+		TPos t;
+		t = x1; x1 = x2; x2 = t;
+		t = y1; y1 = y2; y2 = t;
+		dir = -1;
+	}
+	ey1 = TRUNC(y1 + ONE_PIXEL / 2 - 1);
+	ey2 = TRUNC(y2 + ONE_PIXEL / 2 - 1);
+	if(ey1 < ras.min_ey)
+		ey1 = ras.min_ey;
+	if(ey2 > ras.max_ey)
+		ey2 = ras.max_ey;
+	if(ey1 >= ey2)
+		return;
+	if(ras.num_edges >= ras.max_edges)
+	{
+		if(!ras.raster || !gray_raster_reserve(RAS_VAR_ ras.buffer_size * 2))
+			ft_longjmp(ras.jump_buffer, 1);
+		ras.edges = (TEdge*)ras.buffer;
+		ras.max_edges = ras.buffer_size / (long)sizeof(TEdge);
+	}
+	edge = ras.edges + ras.num_edges++;
+	edge->dxdy = (double)(x2 - x1) / (double)(y2 - y1);
+	edge->x = ((double)x1 + (double)(SUBPIXELS(ey1) + ONE_PIXEL / 2 - y1) * edge->dxdy) / ONE_PIXEL;
+	edge->y1 = ey1;
+	edge->y2 = ey2;
+	edge->dir = dir;
+}
+
 static void gray_render_line(RAS_ARG_ TPos to_x, TPos to_y)
 {
 	TPos dx, dy, fx1, fy1, fx2, fy2;
 	TCoord ex1, ex2, ey1, ey2;
 
+	if(ras.edges)
+	{
+		gray_add_edge(RAS_VAR_ to_x, to_y);
+		return;
+	}
 	ex1 = TRUNC(ras.x);
 	ex2 = TRUNC(to_x);
 	ey1 = TRUNC(ras.y);
@@ -990,6 +1175,42 @@ static int gray_cubic_to(const SW_FT_Vector * control1, const SW_FT_Vector * con
 	return 0;
 }
 
+static void gray_span(RAS_ARG_ TCoord x, TCoord y, TCoord acount, int coverage)
+{
+	SW_FT_Span * span;
+	int count;
+
+	if(x < ras.bound_left)
+		ras.bound_left = x;
+	if(y < ras.bound_top)
+		ras.bound_top = y;
+	if(y > ras.bound_bottom)
+		ras.bound_bottom = y;
+	if(x + acount > ras.bound_right)
+		ras.bound_right = x + acount;
+	count = ras.num_gray_spans;
+	span = ras.gray_spans + count - 1;
+	if(count > 0 && span->y == y && (int)span->x + span->len == (int)x && span->coverage == coverage)
+	{
+		span->len = (int)(span->len + acount);
+		return;
+	}
+	if(count >= SW_FT_MAX_GRAY_SPANS)
+	{
+		if(ras.render_span && count > 0)
+			ras.render_span(count, ras.gray_spans, ras.render_span_data);
+		ras.num_gray_spans = 0;
+		span = ras.gray_spans;
+	}
+	else
+		span++;
+	span->x = (int)x;
+	span->y = (int)y;
+	span->len = (int)acount;
+	span->coverage = (unsigned char)coverage;
+	ras.num_gray_spans++;
+}
+
 static void gray_hline(RAS_ARG_ TCoord x, TCoord y, TPos area, TCoord acount)
 {
 	int coverage;
@@ -1012,45 +1233,12 @@ static void gray_hline(RAS_ARG_ TCoord x, TCoord y, TPos area, TCoord acount)
 	}
 	y += (TCoord)ras.min_ey;
 	x += (TCoord)ras.min_ex;
-	if(x >= 32767)
-		x = 32767;
+	if(x >= SW_FT_INT_MAX)
+		x = SW_FT_INT_MAX;
 	if(y >= SW_FT_INT_MAX)
 		y = SW_FT_INT_MAX;
 	if(coverage)
-	{
-		SW_FT_Span * span;
-		int count;
-
-		if(x < ras.bound_left)
-			ras.bound_left = x;
-		if(y < ras.bound_top)
-			ras.bound_top = y;
-		if(y > ras.bound_bottom)
-			ras.bound_bottom = y;
-		if(x + acount > ras.bound_right)
-			ras.bound_right = x + acount;
-		count = ras.num_gray_spans;
-		span = ras.gray_spans + count - 1;
-		if(count > 0 && span->y == y && (int)span->x + span->len == (int)x && span->coverage == coverage)
-		{
-			span->len = (unsigned short)(span->len + acount);
-			return;
-		}
-		if(count >= SW_FT_MAX_GRAY_SPANS)
-		{
-			if(ras.render_span && count > 0)
-				ras.render_span(count, ras.gray_spans, ras.render_span_data);
-			ras.num_gray_spans = 0;
-			span = ras.gray_spans;
-		}
-		else
-			span++;
-		span->x = (short)x;
-		span->y = (short)y;
-		span->len = (unsigned short)acount;
-		span->coverage = (unsigned char)coverage;
-		ras.num_gray_spans++;
-	}
+		gray_span(RAS_VAR_ x, y, acount, coverage);
 }
 
 static void gray_sweep(RAS_ARG)
@@ -1062,20 +1250,59 @@ static void gray_sweep(RAS_ARG)
 	ras.num_gray_spans = 0;
 	for(yindex = 0; yindex < ras.ycount; yindex++)
 	{
-		PCell cell = ras.ycells[yindex];
+		PCell cell = gray_sort_cells(ras.ycells[yindex]);
+		TCoord cover = 0;
+		TCoord x = 0;
+
+		while(cell != NULL)
+		{
+			TPos area, cx = cell->x;
+			TArea carea = 0;
+			if(cx > x && cover != 0)
+				gray_hline(RAS_VAR_ x, yindex, cover * (ONE_PIXEL * 2), cx - x);
+			for(; cell != NULL && cell->x == cx; cell = cell->next)
+			{
+				cover += cell->cover;
+				carea += cell->area;
+			}
+			area = cover * (ONE_PIXEL * 2) - carea;
+			if(area != 0 && cx >= 0)
+				gray_hline(RAS_VAR_ cx, yindex, area, 1);
+			x = cx + 1;
+		}
+		if(cover != 0)
+			gray_hline(RAS_VAR_ x, yindex, cover * (ONE_PIXEL * 2),
+			ras.count_ex - x);
+	}
+	if(ras.render_span && ras.num_gray_spans > 0)
+		ras.render_span(ras.num_gray_spans, ras.gray_spans, ras.render_span_data);
+}
+
+static void gray_sweep_accum(RAS_ARG)
+{
+	int yindex;
+
+	ras.num_gray_spans = 0;
+	for(yindex = 0; yindex < ras.count_ey; yindex++)
+	{
+		TPos * span = ras.accum_span + yindex * 2;
+		TAccum * row = ras.accum + yindex * ras.accum_pitch + 1;
 		TCoord cover = 0;
 		TCoord x = 0;
+		TPos cx;
 
-		for(; cell != NULL; cell = cell->next)
+		for(cx = span[0]; cx <= span[1]; cx++)
 		{
 			TPos area;
-			if(cell->x > x && cover != 0)
-				gray_hline(RAS_VAR_ x, yindex, cover * (ONE_PIXEL * 2), cell->x - x);
-			cover += cell->cover;
-			area = cover * (ONE_PIXEL * 2) - cell->area;
-			if(area != 0 && cell->x >= 0)
-				gray_hline(RAS_VAR_ cell->x, yindex, area, 1);
-			x = cell->x + 1;
+			if(!(row[cx].cover | row[cx].area))
+				continue;
+			if(cx > x && cover != 0)
+				gray_hline(RAS_VAR_ x, yindex, cover * (ONE_PIXEL * 2), cx - x);
+			cover += row[cx].cover;
+			area = cover * (ONE_PIXEL * 2) - row[cx].area;
+			if(area != 0 && cx >= 0)
+				gray_hline(RAS_VAR_ cx, yindex, area, 1);
+			x = cx + 1;
 		}
 		if(cover != 0)
 			gray_hline(RAS_VAR_ x, yindex, cover * (ONE_PIXEL * 2),
@@ -1085,171 +1312,212 @@ static void gray_sweep(RAS_ARG)
 		ras.render_span(ras.num_gray_spans, ras.gray_spans, ras.render_span_data);
 }
 
-static int SW_FT_Outline_Decompose(const SW_FT_Outline * outline, const SW_FT_Outline_Funcs * func_interface, void * user)
+static int gray_decompose_contour(const SW_FT_Vector * points, const char * tags, int first, int last, const SW_FT_Outline_Funcs * func_interface, void * user)
 {
 #undef SCALED
 #define SCALED(x) (((x) << shift) - delta)
 	SW_FT_Vector v_last;
 	SW_FT_Vector v_control;
 	SW_FT_Vector v_start;
-	SW_FT_Vector *point;
-	SW_FT_Vector *limit;
-	char *tags;
+	const SW_FT_Vector *point;
+	const SW_FT_Vector *limit;
 	int error;
-	int n;
-	int first;
 	char tag;
-	int shift;
-	TPos delta;
-
-	if(!outline || !func_interface)
-		return SW_FT_THROW(Invalid_Argument);
-	shift = func_interface->shift;
-	delta = func_interface->delta;
-	first = 0;
-	for(n = 0; n < outline->n_contours; n++)
+	int shift = func_interface->shift;
+	TPos delta = func_interface->delta;
+
+	limit = points + last;
+	v_start = points[first];
+	v_start.x = SCALED(v_start.x);
+	v_start.y = SCALED(v_start.y);
+	v_last = points[last];
+	v_last.x = SCALED(v_last.x);
+	v_last.y = SCALED(v_last.y);
+	v_control = v_start;
+	point = points + first;
+	tag = SW_FT_CURVE_TAG(tags[first]);
+	if(tag == SW_FT_CURVE_TAG_CUBIC)
+		goto Invalid_Outline;
+	if(tag == SW_FT_CURVE_TAG_CONIC)
+	{
+		if(SW_FT_CURVE_TAG(tags[last]) == SW_FT_CURVE_TAG_ON)
+		{
+			v_start = v_last;
+			limit--;
+		}
+		else
+		{
+			v_start.x = (v_start.x + v_last.x) / 2;
+			v_start.y = (v_start.y + v_last.y) / 2;
+		}
+		point--;
+	}
+	tags += point - points;
+	error = func_interface->move_to(&v_start, user);
+	if(error)
+		goto Exit;
+	while(point < limit)
 	{
-		int last;
-		last = outline->contours[n];
-		if(last < 0)
-			goto Invalid_Outline;
-		limit = outline->points + last;
-		v_start = outline->points[first];
-		v_start.x = SCALED(v_start.x);
-		v_start.y = SCALED(v_start.y);
-		v_last = outline->points[last];
-		v_last.x = SCALED(v_last.x);
-		v_last.y = SCALED(v_last.y);
-		v_control = v_start;
-		point = outline->points + first;
-		tags = outline->tags + first;
+		point++;
+		tags++;
 		tag = SW_FT_CURVE_TAG(tags[0]);
-		if(tag == SW_FT_CURVE_TAG_CUBIC)
-			goto Invalid_Outline;
-		if(tag == SW_FT_CURVE_TAG_CONIC)
+		switch(tag)
 		{
-			if(SW_FT_CURVE_TAG(outline->tags[last]) == SW_FT_CURVE_TAG_ON)
-			{
-				v_start = v_last;
-				limit--;
-			}
-			else
-			{
-				v_start.x = (v_start.x + v_last.x) / 2;
-				v_start.y = (v_start.y + v_last.y) / 2;
-			}
-			point--;
-			tags--;
-		}
-		error = func_interface->move_to(&v_start, user);
-		if(error)
-			goto Exit;
-		while(point < limit)
+		case SW_FT_CURVE_TAG_ON:
 		{
-			point++;
-			tags++;
-			tag = SW_FT_CURVE_TAG(tags[0]);
-			switch(tag)
-			{
-			case SW_FT_CURVE_TAG_ON:
+			SW_FT_Vector vec;
+			vec.x = SCALED(point->x);
+			vec.y = SCALED(point->y);
+			error = func_interface->line_to(&vec, user);
+			if(error)
+				goto Exit;
+			continue;
+		}
+		case SW_FT_CURVE_TAG_CONIC:
+			v_control.x = SCALED(point->x);
+			v_control.y = SCALED(point->y);
+Do_Conic:
+			if(point < limit)
 			{
 				SW_FT_Vector vec;
+				SW_FT_Vector v_middle;
+				point++;
+				tags++;
+				tag = SW_FT_CURVE_TAG(tags[0]);
 				vec.x = SCALED(point->x);
 				vec.y = SCALED(point->y);
-				error = func_interface->line_to(&vec, user);
-				if(error)
-					goto Exit;
-				continue;
-			}
-			case SW_FT_CURVE_TAG_CONIC:
-				v_control.x = SCALED(point->x);
-				v_control.y = SCALED(point->y);
-Do_Conic:
-				if(point < limit)
+				if(tag == SW_FT_CURVE_TAG_ON)
 				{
-					SW_FT_Vector vec;
-					SW_FT_Vector v_middle;
-					point++;
-					tags++;
-					tag = SW_FT_CURVE_TAG(tags[0]);
-					vec.x = SCALED(point->x);
-					vec.y = SCALED(point->y);
-					if(tag == SW_FT_CURVE_TAG_ON)
-					{
-						error = func_interface->conic_to(&v_control, &vec, user);
-						if(error)
-							goto Exit;
-						continue;
-					}
-					if(tag != SW_FT_CURVE_TAG_CONIC)
-						goto Invalid_Outline;
-					v_middle.x = (v_control.x + vec.x) / 2;
-					v_middle.y = (v_control.y + vec.y) / 2;
-					error = func_interface->conic_to(&v_control, &v_middle, user);
-					if(error)
-						goto Exit;
-					v_control = vec;
-					goto Do_Conic;
-				}
-				error = func_interface->conic_to(&v_control, &v_start, user);
-				goto Close;
-			default:
-			{
-				SW_FT_Vector vec1, vec2;
-				if(point + 1 > limit ||
-				SW_FT_CURVE_TAG(tags[1]) != SW_FT_CURVE_TAG_CUBIC)
-					goto Invalid_Outline;
-				point += 2;
-				tags += 2;
-				vec1.x = SCALED(point[-2].x);
-				vec1.y = SCALED(point[-2].y);
-				vec2.x = SCALED(point[-1].x);
-				vec2.y = SCALED(point[-1].y);
-				if(point <= limit)
-				{
-					SW_FT_Vector vec;
-					vec.x = SCALED(point->x);
-					vec.y = SCALED(point->y);
-					error = func_interface->cubic_to(&vec1, &vec2, &vec, user);
+					error = func_interface->conic_to(&v_control, &vec, user);
 					if(error)
 						goto Exit;
 					continue;
 				}
-				error = func_interface->cubic_to(&vec1, &vec2, &v_start, user);
-				goto Close;
+				if(tag != SW_FT_CURVE_TAG_CONIC)
+					goto Invalid_Outline;
+				v_middle.x = (v_control.x + vec.x) / 2;
+				v_middle.y = (v_control.y + vec.y) / 2;
+				error = func_interface->conic_to(&v_control, &v_middle, user);
+				if(error)
+					goto Exit;
+				v_control = vec;
+				goto Do_Conic;
 			}
+			return func_interface->conic_to(&v_control, &v_start, user);
+		default:
+		{
+			SW_FT_Vector vec1, vec2;
+			if(point + 1 > limit ||
+			SW_FT_CURVE_TAG(tags[1]) != SW_FT_CURVE_TAG_CUBIC)
+				goto Invalid_Outline;
+			point += 2;
+			tags += 2;
+			vec1.x = SCALED(point[-2].x);
+			vec1.y = SCALED(point[-2].y);
+			vec2.x = SCALED(point[-1].x);
+			vec2.y = SCALED(point[-1].y);
+			if(point <= limit)
+			{
+				SW_FT_Vector vec;
+				vec.x = SCALED(point->x);
+				vec.y = SCALED(point->y);
+				error = func_interface->cubic_to(&vec1, &vec2, &vec, user);
+				if(error)
+					goto Exit;
+				continue;
 			}
+			return func_interface->cubic_to(&vec1, &vec2, &v_start, user);
+		}
 		}
-		error = func_interface->line_to(&v_start, user);
-Close:
-		if(error)
-			goto Exit;
-		first = last + 1;
 	}
-	return 0;
+	return func_interface->line_to(&v_start, user);
 Exit:
 	return error;
 Invalid_Outline:
 	return SW_FT_THROW(Invalid_Outline);
 }
 
+static int SW_FT_Outline_Decompose(const SW_FT_Outline * outline, const SW_FT_Outline_Funcs * func_interface, void * user)
+{
+	int error;
+	int n;
+	int first;
+
+	if(!outline || !func_interface)
+		return SW_FT_THROW(Invalid_Argument);
+	first = 0;
+	for(n = 0; n < outline->n_contours; n++)
+	{
+		int last;
+		last = outline->contours[n];
+		if(last < 0)
+			return SW_FT_THROW(Invalid_Outline);
+		error = gray_decompose_contour(outline->points, outline->tags, first, last, func_interface, user);
+		if(error)
+			return error;
+		first = last + 1;
+	}
+	return 0;
+}
+
 typedef struct gray_TBand_ {
 	TPos min, max;
 } gray_TBand;
 
+static int ft_stroker_decompose(SW_FT_Stroker stroker, const SW_FT_Outline_Funcs * func_interface, void * user);
+
 SW_FT_DEFINE_OUTLINE_FUNCS(func_interface,
 		(SW_FT_Outline_MoveTo_Func)gray_move_to,
 		(SW_FT_Outline_LineTo_Func)gray_line_to,
 		(SW_FT_Outline_ConicTo_Func)gray_conic_to,
 		(SW_FT_Outline_CubicTo_Func)gray_cubic_to, 0, 0)
 
+static TPos gray_polygon_coord(double v)
+{
+	double limit = (double)(SW_FT_INT_MAX >> PIXEL_BITS);
+
+	if(!(v > -limit))
+		v = -limit;
+	else if(v > limit)
+		v = limit;
+	return (TPos)floor(v * ONE_PIXEL + 0.5);
+}
+
+static void gray_polygon_decompose(RAS_ARG_ const SW_FT_Polygon * polygon)
+{
+	int first = 0;
+
+	for(int n = 0; n < polygon->n_contours; n++)
+	{
+		int last = polygon->contours[n];
+		if(last < first)
+			continue;
+		TPos x0 = gray_polygon_coord(polygon->points[first].x);
+		TPos y0 = gray_polygon_coord(polygon->points[first].y);
+		if(!ras.invalid)
+			gray_record_cell(RAS_VAR);
+		gray_start_cell(RAS_VAR_ TRUNC(x0), TRUNC(y0));
+		ras.x = x0;
+		ras.y = y0;
+		for(int i = first + 1; i <= last; i++)
+			gray_render_line(RAS_VAR_ gray_polygon_coord(polygon->points[i].x), gray_polygon_coord(polygon->points[i].y));
+		gray_render_line(RAS_VAR_ x0, y0);
+		first = last + 1;
+	}
+}
+
 static int gray_convert_glyph_inner(RAS_ARG)
 {
 	volatile int error = 0;
 
 	if(ft_setjmp(ras.jump_buffer) == 0)
 	{
-		error = SW_FT_Outline_Decompose(&ras.outline, &func_interface, &ras);
+		if(ras.stroker)
+			error = ft_stroker_decompose(ras.stroker, &func_interface, &ras);
+		else if(ras.polygon)
+			gray_polygon_decompose(RAS_VAR_ ras.polygon);
+		else
+			error = SW_FT_Outline_Decompose(&ras.outline, &func_interface, &ras);
 		if(!ras.invalid)
 			gray_record_cell(RAS_VAR);
 	}
@@ -1258,6 +1526,170 @@ static int gray_convert_glyph_inner(RAS_ARG)
 	return error;
 }
 
+static int gray_edge_compare(const void * a, const void * b)
+{
+	const TEdge * e1 = a;
+	const TEdge * e2 = b;
+	return (e1->y1 > e2->y1) - (e1->y1 < e2->y1);
+}
+
+static void gray_mono_span(RAS_ARG_ double x1, double x2, TCoord y)
+{
+	TPos ex1 = (TPos)ceil(x1 - 0.5);
+	TPos ex2 = (TPos)ceil(x2 - 0.5);
+
+	if(ex1 < ras.min_ex)
+		ex1 = ras.min_ex;
+	if(ex2 > ras.max_ex)
+		ex2 = ras.max_ex;
+	if(ex1 < ex2)
+		gray_span(RAS_VAR_ ex1, y, ex2 - ex1, 255);
+}
+
+static void gray_sweep_mono(RAS_ARG_ TEdge ** active)
+{
+	TEdge * edges = ras.edges;
+	SW_FT_PtrDist n = ras.num_edges, next = 0;
+	int nactive = 0, even_odd = (ras.outline.flags & SW_FT_OUTLINE_EVEN_ODD_FILL) ? 1 : 0;
+	TCoord y = 0;
+	int i, j;
+
+	qsort(edges, (size_t)n, sizeof(TEdge), gray_edge_compare);
+	ras.num_gray_spans = 0;
+	while(next < n || nactive > 0)
+	{
+		double x1 = 0;
+		int winding = 0;
+
+		if(nactive == 0)
+			y = edges[next].y1;
+		while(next < n && edges[next].y1 == y)
+			active[nactive++] = &edges[next++];
+		for(i = 1; i < nactive; i++)
+		{
+			TEdge * e = active[i];
+			for(j = i; j > 0 && active[j - 1]->x > e->x; j--)
+				active[j] = active[j - 1];
+			active[j] = e;
+		}
+		for(i = 0; i < nactive; i++)
+		{
+			int inside = even_odd ? (winding & 1) : (winding != 0);
+			winding += active[i]->dir;
+			if(inside != (even_odd ? (winding & 1) : (winding != 0)))
+			{
+				if(inside)
+					gray_mono_span(RAS_VAR_ x1, active[i]->x, y);
+				else
+					x1 = active[i]->x;
+			}
+		}
+		y++;
+		for(i = 0, j = 0; i < nactive; i++)
+		{
+			TEdge * e = active[i];
+			if(e->y2 > y)
+			{
+				e->x += e->dxdy;
+				active[j++] = e;
+			}
+		}
+		nactive = j;
+	}
+	if(ras.render_span && ras.num_gray_spans > 0)
+		ras.render_span(ras.num_gray_spans, ras.gray_spans, ras.render_span_data);
+}
+
+static int gray_convert_mono_band(RAS_ARG)
+{
+	long size;
+
+	ras.edges = (TEdge*)ras.buffer;
+	ras.num_edges = 0;
+	ras.max_edges = ras.buffer_size / (long)sizeof(TEdge);
+	if(gray_convert_glyph_inner(RAS_VAR))
+	{
+		ras.edges = NULL;
+		return 1;
+	}
+	size = (long)((sizeof(TEdge) + sizeof(TEdge*)) * ras.num_edges);
+	if(size > ras.buffer_size && (!ras.raster || !gray_raster_reserve(RAS_VAR_ size)))
+	{
+		ras.edges = NULL;
+		return 1;
+	}
+	ras.edges = (TEdge*)ras.buffer;
+	gray_sweep_mono(RAS_VAR_ (TEdge**)(ras.edges + ras.num_edges));
+	ras.edges = NULL;
+	return 0;
+}
+
+static int gray_convert_mono(RAS_ARG)
+{
+	TPos min = ras.min_ey, max_y = ras.max_ey;
+	TPos rows = max_y - min;
+
+	while(min < max_y)
+	{
+		ras.min_ey = min;
+		ras.max_ey = (max_y - min > rows) ? min + rows : max_y;
+		if(gray_convert_mono_band(RAS_VAR) == 0)
+			min = ras.max_ey;
+		else if(rows > 1)
+			rows = rows / 2;
+		else
+			break;
+	}
+	ras.min_ey = min;
+	ras.max_ey = max_y;
+	ras.count_ey = max_y - min;
+	return (min < max_y) ? 1 : 0;
+}
+
+static int gray_convert_accum(RAS_ARG)
+{
+	TPos pitch = ras.count_ex + 1;
+	long row_size = (long)(sizeof(TPos) * 2 + sizeof(TAccum) * pitch);
+	long rows = SW_FT_ACCUM_POOL_SIZE / row_size;
+	TPos min, max_y = ras.max_ey;
+	int yindex;
+
+	if(rows < 1)
+		rows = 1;
+	if(rows > ras.count_ey)
+		rows = ras.count_ey;
+	if(ras.raster)
+	{
+		if(!gray_raster_reserve(RAS_VAR_ rows * row_size))
+			return -1;
+	}
+	else
+	{
+		rows = ras.buffer_size / row_size;
+		if(rows < 1)
+			return -1;
+	}
+	ras.accum_span = (TPos*)ras.buffer;
+	ras.accum = (TAccum*)(ras.accum_span + rows * 2);
+	ras.accum_pitch = pitch;
+	for(min = ras.min_ey; min < max_y; min += rows)
+	{
+		ras.min_ey = min;
+		ras.max_ey = (max_y - min > rows) ? min + rows : max_y;
+		ras.count_ey = ras.max_ey - min;
+		for(yindex = 0; yindex < ras.count_ey; yindex++)
+		{
+			ras.accum_span[yindex * 2] = ras.count_ex;
+			ras.accum_span[yindex * 2 + 1] = -2;
+		}
+		ras.invalid = 1;
+		if(gray_convert_glyph_inner(RAS_VAR))
+			return 1;
+		gray_sweep_accum(RAS_VAR);
+	}
+	return 0;
+}
+
 static int gray_convert_glyph(RAS_ARG)
 {
 	gray_TBand bands[40];
@@ -1281,7 +1713,20 @@ static int gray_convert_glyph(RAS_ARG)
 		ras.max_ey = clip->yMax;
 	ras.count_ex = ras.max_ex - ras.min_ex;
 	ras.count_ey = ras.max_ey - ras.min_ey;
-	num_bands = (int)((ras.max_ey - ras.min_ey) / ras.band_size);
+	if(ras.mono)
+	{
+		if(gray_convert_mono(RAS_VAR) == 0)
+			return 0;
+		ras.mono = 0;
+	}
+	if(ras.accumulate)
+	{
+		int error = gray_convert_accum(RAS_VAR);
+		ras.accum = NULL;
+		if(error >= 0)
+			return error;
+	}
+	num_bands = ras.raster ? 1 : (int)((ras.max_ey - ras.min_ey) / ras.band_size);
 	if(num_bands == 0)
 		num_bands = 1;
 	if(num_bands >= 39)
@@ -1305,9 +1750,11 @@ static int gray_convert_glyph(RAS_ARG)
 				PCell cells_max;
 				int yindex;
 				long cell_start, cell_end, cell_mod;
-				ras.ycells = (PCell*)ras.buffer;
 				ras.ycount = band->max - band->min;
 				cell_start = sizeof(PCell) * ras.ycount;
+				if(ras.raster)
+					gray_raster_reserve(RAS_VAR_ cell_start + SW_FT_RENDER_POOL_SIZE);
+				ras.ycells = (PCell*)ras.buffer;
 				cell_mod = cell_start % sizeof(TCell);
 				if(cell_mod > 0)
 					cell_start += sizeof(TCell) - cell_mod;
@@ -1361,33 +1808,63 @@ ReduceBands:
 
 static int gray_raster_render(gray_PRaster raster, const SW_FT_Raster_Params * params)
 {
-	SW_FT_UNUSED(raster);
 	const SW_FT_Outline * outline = (const SW_FT_Outline*)params->source;
 	gray_TWorker worker[1];
 	TCell buffer[SW_FT_RENDER_POOL_SIZE / sizeof(TCell)];
 	long buffer_size = sizeof(buffer);
 	int band_size = (int)(buffer_size / (long)(sizeof(TCell) * 8));
+	SW_FT_Stroker stroker = NULL;
+	const SW_FT_Polygon * polygon = NULL;
 	if(!outline)
 		return SW_FT_THROW(Invalid_Outline);
-	if(outline->n_points == 0 || outline->n_contours <= 0)
-		return 0;
-	if(!outline->contours || !outline->points)
-		return SW_FT_THROW(Invalid_Outline);
-	if(outline->n_points != outline->contours[outline->n_contours - 1] + 1)
-		return SW_FT_THROW(Invalid_Outline);
-	if(!(params->flags & SW_FT_RASTER_FLAG_AA))
-		return SW_FT_THROW(Invalid_Mode);
+	if(params->flags & SW_FT_RASTER_FLAG_STROKER)
+		stroker = (SW_FT_Stroker)params->source;
+	else if(params->flags & SW_FT_RASTER_FLAG_POLYGON)
+	{
+		polygon = (const SW_FT_Polygon *)params->source;
+		if(polygon->n_points == 0 || polygon->n_contours <= 0)
+			return 0;
+		if(!polygon->contours || !polygon->points)
+			return SW_FT_THROW(Invalid_Outline);
+		if(polygon->n_points != polygon->contours[polygon->n_contours - 1] + 1)
+			return SW_FT_THROW(Invalid_Outline);
+	}
+	else
+	{
+		if(outline->n_points == 0 || outline->n_contours <= 0)
+			return 0;
+		if(!outline->contours || !outline->points)
+			return SW_FT_THROW(Invalid_Outline);
+		if(outline->n_points != outline->contours[outline->n_contours - 1] + 1)
+			return SW_FT_THROW(Invalid_Outline);
+	}
 	if(params->flags & SW_FT_RASTER_FLAG_CLIP)
 		ras.clip_box = params->clip_box;
 	else
 	{
-		ras.clip_box.xMin = -32768L;
-		ras.clip_box.yMin = -32768L;
-		ras.clip_box.xMax = 32767L;
-		ras.clip_box.yMax = 32767L;
+		ras.clip_box.xMin = -SW_FT_INT_MAX;
+		ras.clip_box.yMin = -SW_FT_INT_MAX;
+		ras.clip_box.xMax = SW_FT_INT_MAX;
+		ras.clip_box.yMax = SW_FT_INT_MAX;
+	}
+	if(raster && raster->buffer)
+		gray_init_cells(RAS_VAR_ raster->buffer, raster->buffer_size);
+	else
+		gray_init_cells(RAS_VAR_ buffer, buffer_size);
+	ras.raster = (raster && raster->buffer) ? raster : NULL;
+	if(stroker)
+		memset(&ras.outline, 0, sizeof(SW_FT_Outline));
+	else if(polygon)
+	{
+		memset(&ras.outline, 0, sizeof(SW_FT_Outline));
+		ras.outline.flags = polygon->flags;
 	}
-	gray_init_cells(RAS_VAR_ buffer, buffer_size);
-	ras.outline = *outline;
+	else
+		ras.outline = *outline;
+	ras.stroker = stroker;
+	ras.polygon = polygon;
+	ras.accumulate = (params->flags & SW_FT_RASTER_FLAG_ACCUMULATE) ? 1 : 0;
+	ras.mono = (params->flags & SW_FT_RASTER_FLAG_AA) ? 0 : 1;
 	ras.num_cells = 0;
 	ras.invalid = 1;
 	ras.band_size = band_size;
@@ -1403,22 +1880,40 @@ static int gray_raster_render(gray_PRaster raster, const SW_FT_Raster_Params * p
 
 static int gray_raster_new(SW_FT_Raster *araster)
 {
-	static gray_TRaster the_raster;
-	*araster = (SW_FT_Raster)&the_raster;
-	SW_FT_MEM_ZERO(&the_raster, sizeof(the_raster));
+	gray_PRaster raster = malloc(sizeof(gray_TRaster));
+	*araster = (SW_FT_Raster)raster;
+	if(!raster)
+		return SW_FT_THROW(Memory_Overflow);
+	SW_FT_MEM_ZERO(raster, sizeof(gray_TRaster));
+	raster->buffer = malloc(SW_FT_RENDER_POOL_SIZE);
+	if(raster->buffer)
+		raster->buffer_size = SW_FT_RENDER_POOL_SIZE;
 	return 0;
 }
 
 static void gray_raster_done(SW_FT_Raster raster)
 {
-	SW_FT_UNUSED(raster);
+	gray_PRaster rast = (gray_PRaster)raster;
+	if(rast)
+	{
+		free(rast->buffer);
+		free(rast);
+	}
 }
 
 static void gray_raster_reset(SW_FT_Raster raster, char *pool_base, long pool_size)
 {
-	SW_FT_UNUSED(raster);
+	gray_PRaster rast = (gray_PRaster)raster;
 	SW_FT_UNUSED(pool_base);
-	SW_FT_UNUSED(pool_size);
+	if(rast && (pool_size > rast->buffer_size) && (pool_size <= SW_FT_RENDER_POOL_MAX))
+	{
+		void * buffer = realloc(rast->buffer, (size_t)pool_size);
+		if(buffer)
+		{
+			rast->buffer = buffer;
+			rast->buffer_size = pool_size;
+		}
+	}
 }
 
 SW_FT_DEFINE_RASTER_FUNCS(sw_ft_grays_raster,
@@ -1655,6 +2150,42 @@ Bad:
 	return -1;
 }
 
+void SW_FT_Polygon_Get_CBox(const SW_FT_Polygon * polygon, SW_FT_BBox * acbox)
+{
+	if(polygon && acbox)
+	{
+		if(polygon->n_points == 0)
+		{
+			acbox->xMin = 0;
+			acbox->yMin = 0;
+			acbox->xMax = 0;
+			acbox->yMax = 0;
+		}
+		else
+		{
+			double xMin = polygon->points[0].x, xMax = xMin;
+			double yMin = polygon->points[0].y, yMax = yMin;
+			for(int i = 1; i < polygon->n_points; i++)
+			{
+				double x = polygon->points[i].x;
+				double y = polygon->points[i].y;
+				if(x < xMin)
+					xMin = x;
+				if(x > xMax)
+					xMax = x;
+				if(y < yMin)
+					yMin = y;
+				if(y > yMax)
+					yMax = y;
+			}
+			acbox->xMin = DOWNSCALE(gray_polygon_coord(xMin));
+			acbox->yMin = DOWNSCALE(gray_polygon_coord(yMin));
+			acbox->xMax = DOWNSCALE(gray_polygon_coord(xMax) + ONE_PIXEL / 64 - 1);
+			acbox->yMax = DOWNSCALE(gray_polygon_coord(yMax) + ONE_PIXEL / 64 - 1);
+		}
+	}
+}
+
 void SW_FT_Outline_Get_CBox(const SW_FT_Outline * outline, SW_FT_BBox * acbox)
 {
 	SW_FT_Pos xMin, yMin, xMax, yMax;
@@ -1963,8 +2494,8 @@ static void ft_stroke_border_export(SW_FT_StrokeBorder border, SW_FT_Outline *ou
 	{
 		SW_FT_UInt count = border->num_points;
 		SW_FT_Byte *tags = border->tags;
-		SW_FT_Short *write = outline->contours + outline->n_contours;
-		SW_FT_Short idx = (SW_FT_Short)outline->n_points;
+		SW_FT_Int *write = outline->contours + outline->n_contours;
+		SW_FT_Int idx = outline->n_points;
 		for(; count > 0; count--, tags++, idx++)
 		{
 			if(*tags & SW_FT_STROKE_TAG_END)
@@ -1974,7 +2505,7 @@ static void ft_stroke_border_export(SW_FT_StrokeBorder border, SW_FT_Outline *ou
 			}
 		}
 	}
-	outline->n_points = (short)(outline->n_points + border->num_points);
+	outline->n_points = (SW_FT_Int)(outline->n_points + border->num_points);
 	SW_FT_Outline_Check(outline);
 }
 
@@ -2753,6 +3284,68 @@ void SW_FT_Stroker_Export(SW_FT_Stroker stroker, SW_FT_Outline * outline)
 	SW_FT_Stroker_ExportBorder(stroker, SW_FT_STROKER_BORDER_RIGHT, outline);
 }
 
+void SW_FT_Stroker_GetCBox(SW_FT_Stroker stroker, SW_FT_BBox * acbox)
+{
+	SW_FT_Pos xMin = 0, yMin = 0, xMax = 0, yMax = 0;
+	SW_FT_Bool empty = TRUE;
+	SW_FT_Int n;
+
+	for(n = 0; n < 2; n++)
+	{
+		SW_FT_StrokeBorder border = &stroker->borders[n];
+		SW_FT_Vector * vec = border->points;
+		SW_FT_Vector * limit = vec + border->num_points;
+		if(!border->valid || border->num_points == 0)
+			continue;
+		if(empty)
+		{
+			xMin = xMax = vec->x;
+			yMin = yMax = vec->y;
+			empty = FALSE;
+		}
+		for(; vec < limit; vec++)
+		{
+			if(vec->x < xMin)
+				xMin = vec->x;
+			if(vec->x > xMax)
+				xMax = vec->x;
+			if(vec->y < yMin)
+				yMin = vec->y;
+			if(vec->y > yMax)
+				yMax = vec->y;
+		}
+	}
+	acbox->xMin = xMin;
+	acbox->yMin = yMin;
+	acbox->xMax = xMax;
+	acbox->yMax = yMax;
+}
+
+static int ft_stroker_decompose(SW_FT_Stroker stroker, const SW_FT_Outline_Funcs * func_interface, void * user)
+{
+	SW_FT_Int n;
+
+	for(n = 0; n < 2; n++)
+	{
+		SW_FT_StrokeBorder border = &stroker->borders[n];
+		SW_FT_UInt first = 0;
+		SW_FT_UInt i;
+		if(!border->valid)
+			continue;
+		for(i = 0; i < border->num_points; i++)
+		{
+			if(border->tags[i] & SW_FT_STROKE_TAG_END)
+			{
+				int error = gray_decompose_contour(border->points, (const char *)border->tags, (int)first, (int)i, func_interface, user);
+				if(error)
+					return error;
+				first = i + 1;
+			}
+		}
+	}
+	return 0;
+}
+
 SW_FT_Error SW_FT_Stroker_ParseOutline(SW_FT_Stroker stroker, const SW_FT_Outline * outline)
 {
 	SW_FT_Vector v_last;
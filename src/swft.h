@@ -58,11 +58,11 @@ typedef struct SW_FT_BBox_ {
 } SW_FT_BBox;
 
 typedef struct SW_FT_Outline_ {
-	short n_contours;
-	short n_points;
+	int n_contours;
+	int n_points;
 	SW_FT_Vector * points;
 	char * tags;
-	short * contours;
+	int * contours;
 	char * contours_flag;
 	int flags;
 } SW_FT_Outline;
@@ -79,12 +79,25 @@ typedef struct SW_FT_Outline_ {
 #define SW_FT_Curve_Tag_Conic		SW_FT_CURVE_TAG_CONIC
 #define SW_FT_Curve_Tag_Cubic		SW_FT_CURVE_TAG_CUBIC
 
+typedef struct SW_FT_Point_ {
+	double x;
+	double y;
+} SW_FT_Point;
+
+typedef struct SW_FT_Polygon_ {
+	int n_contours;
+	int n_points;
+	SW_FT_Point * points;
+	int * contours;
+	int flags;
+} SW_FT_Polygon;
+
 typedef struct SW_FT_RasterRec_ * SW_FT_Raster;
 
 typedef struct SW_FT_Span_ {
-	short x;
-	short y;
-	unsigned short len;
+	int x;
+	int y;
+	int len;
 	unsigned char coverage;
 } SW_FT_Span;
 
@@ -96,6 +109,9 @@ typedef void (*SW_FT_BboxFunc)(int x, int y, int w, int h, void * user);
 #define SW_FT_RASTER_FLAG_AA		0x1
 #define SW_FT_RASTER_FLAG_DIRECT	0x2
 #define SW_FT_RASTER_FLAG_CLIP		0x4
+#define SW_FT_RASTER_FLAG_STROKER	0x8
+#define SW_FT_RASTER_FLAG_POLYGON	0x10
+#define SW_FT_RASTER_FLAG_ACCUMULATE	0x20
 
 typedef struct SW_FT_Raster_Params_ {
 	const void * source;
@@ -108,6 +124,7 @@ typedef struct SW_FT_Raster_Params_ {
 
 SW_FT_Error SW_FT_Outline_Check(SW_FT_Outline *outline);
 void SW_FT_Outline_Get_CBox(const SW_FT_Outline *outline, SW_FT_BBox *acbox);
+void SW_FT_Polygon_Get_CBox(const SW_FT_Polygon *polygon, SW_FT_BBox *acbox);
 typedef int (*SW_FT_Raster_NewFunc)(SW_FT_Raster *raster);
 #define SW_FT_Raster_New_Func  SW_FT_Raster_NewFunc
 typedef void (*SW_FT_Raster_DoneFunc)(SW_FT_Raster raster);
@@ -149,10 +166,12 @@ typedef enum SW_FT_StrokerBorder_ {
 } SW_FT_StrokerBorder;
 
 SW_FT_Error SW_FT_Stroker_New(SW_FT_Stroker * astroker);
+void SW_FT_Stroker_Rewind(SW_FT_Stroker stroker);
 void SW_FT_Stroker_Set(SW_FT_Stroker stroker, SW_FT_Fixed radius, SW_FT_Stroker_LineCap line_cap, SW_FT_Stroker_LineJoin line_join, SW_FT_Fixed miter_limit);
 SW_FT_Error SW_FT_Stroker_ParseOutline(SW_FT_Stroker stroker, const SW_FT_Outline * outline);
 SW_FT_Error SW_FT_Stroker_GetCounts(SW_FT_Stroker stroker, SW_FT_UInt * anum_points, SW_FT_UInt * anum_contours);
 void SW_FT_Stroker_Export(SW_FT_Stroker stroker, SW_FT_Outline *outline);
+void SW_FT_Stroker_GetCBox(SW_FT_Stroker stroker, SW_FT_BBox * acbox);
 void SW_FT_Stroker_Done(SW_FT_Stroker stroker);
 
 #endif /* __SWFT_H__ */
@@ -0,0 +1,142 @@
+/*
+ * Checks cg_set_antialias(CG_ANTIALIAS_NONE): every pixel is either fully
+ * covered or untouched, a pixel is covered when its center is inside the
+ * shape, and direct, threaded and recorded drawing agree.
+ */
+#include <cg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define WIDTH	200
+#define HEIGHT	200
+
+static const double triangle[3][2] = {
+	{ 10.2, 5.7 },
+	{ 90.6, 30.3 },
+	{ 25.4, 95.1 },
+};
+
+static const double circle[3] = { 150.3, 60.7, 35.2 };
+
+static void draw(struct cg_ctx_t * ctx)
+{
+	cg_set_antialias(ctx, CG_ANTIALIAS_NONE);
+	cg_set_source_rgb(ctx, 1, 1, 1);
+	cg_paint(ctx);
+	cg_set_source_rgb(ctx, 0, 0, 0);
+	cg_move_to(ctx, triangle[0][0], triangle[0][1]);
+	cg_line_to(ctx, triangle[1][0], triangle[1][1]);
+	cg_line_to(ctx, triangle[2][0], triangle[2][1]);
+	cg_close_path(ctx);
+	cg_fill(ctx);
+	cg_arc(ctx, circle[0], circle[1], circle[2], 0, 2 * M_PI);
+	cg_fill(ctx);
+	cg_set_line_width(ctx, 3.3);
+	cg_move_to(ctx, 20.3, 150.2);
+	cg_line_to(ctx, 180.7, 170.9);
+	cg_curve_to(ctx, 120.4, 190.1, 60.8, 110.6, 30.5, 180.2);
+	cg_stroke(ctx);
+}
+
+static struct cg_surface_t * render(int mode)
+{
+	struct cg_surface_t * surface = cg_surface_create(WIDTH, HEIGHT);
+	struct cg_ctx_t * ctx = cg_create(surface);
+	if(mode > 0)
+		cg_set_threads(ctx, 4);
+	if(mode == 2)
+	{
+		cg_begin_recording(ctx);
+		draw(ctx);
+		struct cg_display_list_t * list = cg_end_recording(ctx);
+		cg_display_list_replay(ctx, list);
+		cg_display_list_destroy(list);
+	}
+	else
+		draw(ctx);
+	cg_destroy(ctx);
+	return surface;
+}
+
+static double edge(const double * a, const double * b, double x, double y)
+{
+	double dx = b[0] - a[0];
+	double dy = b[1] - a[1];
+	return ((x - a[0]) * dy - (y - a[1]) * dx) / sqrt(dx * dx + dy * dy);
+}
+
+/* Returns 1 inside, 0 outside, -1 when the point is too close to call */
+static int inside_triangle(double x, double y)
+{
+	double e0 = edge(triangle[0], triangle[1], x, y);
+	double e1 = edge(triangle[1], triangle[2], x, y);
+	double e2 = edge(triangle[2], triangle[0], x, y);
+	if(fabs(e0) < 0.01 || fabs(e1) < 0.01 || fabs(e2) < 0.01)
+		return -1;
+	return ((e0 > 0) && (e1 > 0) && (e2 > 0)) || ((e0 < 0) && (e1 < 0) && (e2 < 0));
+}
+
+static int inside_circle(double x, double y)
+{
+	double d = sqrt((x - circle[0]) * (x - circle[0]) + (y - circle[1]) * (y - circle[1])) - circle[2];
+	if(fabs(d) < 0.3)
+		return -1;
+	return d < 0;
+}
+
+int main(int argc, char * argv[])
+{
+	static const char * modes[] = { "direct", "threaded", "recorded" };
+	struct cg_surface_t * surface = render(0);
+	uint32_t * pixels = surface->pixels;
+	int failed = 0;
+
+	for(int i = 0; i < WIDTH * HEIGHT; i++)
+	{
+		if((pixels[i] != 0xffffffff) && (pixels[i] != 0xff000000))
+		{
+			printf("pixel %d,%d is partially covered: %08x\n", i % WIDTH, i / WIDTH, pixels[i]);
+			failed = 1;
+			break;
+		}
+	}
+	for(int y = 0; y < 100; y++)
+	{
+		for(int x = 0; x < 100; x++)
+		{
+			int expect = inside_triangle(x + 0.5, y + 0.5);
+			int covered = (pixels[y * WIDTH + x] == 0xff000000);
+			if((expect >= 0) && (covered != expect))
+			{
+				printf("triangle pixel %d,%d: covered %d, center inside %d\n", x, y, covered, expect);
+				failed = 1;
+			}
+		}
+	}
+	for(int y = 20; y < 100; y++)
+	{
+		for(int x = 110; x < WIDTH; x++)
+		{
+			int expect = inside_circle(x + 0.5, y + 0.5);
+			int covered = (pixels[y * WIDTH + x] == 0xff000000);
+			if((expect >= 0) && (covered != expect))
+			{
+				printf("circle pixel %d,%d: covered %d, center inside %d\n", x, y, covered, expect);
+				failed = 1;
+			}
+		}
+	}
+	for(int mode = 1; mode < 3; mode++)
+	{
+		struct cg_surface_t * other = render(mode);
+		if(memcmp(other->pixels, surface->pixels, (size_t)(surface->stride * surface->height)))
+		{
+			printf("%s drawing differs from direct drawing\n", modes[mode]);
+			failed = 1;
+		}
+		cg_surface_destroy(other);
+	}
+	cg_surface_destroy(surface);
+	printf("antialias: %s\n", failed ? "FAILED" : "ok");
+	return failed;
+}
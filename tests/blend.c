@@ -0,0 +1,302 @@
+/*
+ * Checks the operators from CG_OPERATOR_CLEAR to CG_OPERATOR_EXCLUSION
+ * against a floating point model of their formulas, and the SSE2/AVX2
+ * kernels against the scalar ones bit for bit.
+ */
+#include "../src/cg.c"
+#include <stdio.h>
+
+#define NPIXEL	1027
+
+typedef void (*comp_t)(uint32_t * dst, int len, uint32_t * src, uint32_t alpha);
+typedef void (*comp_solid_t)(uint32_t * dst, int len, uint32_t color, uint32_t alpha);
+
+struct kernel_t {
+	const char * name;
+	enum cg_operator_t op;
+	comp_t span[3];
+	comp_solid_t solid[3];
+};
+
+#ifdef CG_SIMD_X86
+#define KERNEL(name, op) \
+	{ #name, op, { __cg_comp_##name, cg_comp_##name##_sse2, cg_comp_##name##_avx2 }, { __cg_comp_solid_##name, cg_comp_solid_##name##_sse2, cg_comp_solid_##name##_avx2 } }
+#define KERNEL_SCALAR(name, op) \
+	{ #name, op, { __cg_comp_##name, NULL, NULL }, { __cg_comp_solid_##name, NULL, NULL } }
+#else
+#define KERNEL(name, op) \
+	{ #name, op, { __cg_comp_##name, NULL, NULL }, { __cg_comp_solid_##name, NULL, NULL } }
+#define KERNEL_SCALAR(name, op)	KERNEL(name, op)
+#endif
+
+static const struct kernel_t kernels[] = {
+	KERNEL(clear, CG_OPERATOR_CLEAR),
+	KERNEL_SCALAR(destination, CG_OPERATOR_DST),
+	KERNEL(source_in, CG_OPERATOR_SRC_IN),
+	KERNEL(source_out, CG_OPERATOR_SRC_OUT),
+	KERNEL(source_atop, CG_OPERATOR_SRC_ATOP),
+	KERNEL(destination_over, CG_OPERATOR_DST_OVER),
+	KERNEL(destination_atop, CG_OPERATOR_DST_ATOP),
+	KERNEL(xor, CG_OPERATOR_XOR),
+	KERNEL(add, CG_OPERATOR_ADD),
+	KERNEL(multiply, CG_OPERATOR_MULTIPLY),
+	KERNEL(screen, CG_OPERATOR_SCREEN),
+	KERNEL(overlay, CG_OPERATOR_OVERLAY),
+	KERNEL(darken, CG_OPERATOR_DARKEN),
+	KERNEL(lighten, CG_OPERATOR_LIGHTEN),
+	KERNEL_SCALAR(color_dodge, CG_OPERATOR_COLOR_DODGE),
+	KERNEL_SCALAR(color_burn, CG_OPERATOR_COLOR_BURN),
+	KERNEL(hard_light, CG_OPERATOR_HARD_LIGHT),
+	KERNEL_SCALAR(soft_light, CG_OPERATOR_SOFT_LIGHT),
+	KERNEL(difference, CG_OPERATOR_DIFFERENCE),
+	KERNEL(exclusion, CG_OPERATOR_EXCLUSION),
+};
+
+static uint32_t seed = 0x12345678;
+
+static uint32_t random_byte(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) & 0xff;
+}
+
+static uint32_t random_pixel(void)
+{
+	static const uint32_t edges[] = { 0, 1, 127, 128, 254, 255 };
+	uint32_t a = (random_byte() & 1) ? edges[random_byte() % 6] : random_byte();
+	uint32_t p = a << 24;
+	for(int i = 0; i < 24; i += 8)
+		p |= (a ? random_byte() % (a + 1) : 0) << i;
+	return p;
+}
+
+static double hard_light(double s, double d, double sa, double da)
+{
+	if(2 * s <= sa)
+		return 2 * s * d;
+	return sa * da - 2 * (da - d) * (sa - s);
+}
+
+static int porter_duff(enum cg_operator_t op, double sa, double da, double * fs, double * fd)
+{
+	switch(op)
+	{
+	case CG_OPERATOR_CLEAR:
+		*fs = 0;
+		*fd = 0;
+		break;
+	case CG_OPERATOR_DST:
+		*fs = 0;
+		*fd = 1;
+		break;
+	case CG_OPERATOR_SRC_IN:
+		*fs = da;
+		*fd = 0;
+		break;
+	case CG_OPERATOR_SRC_OUT:
+		*fs = 1 - da;
+		*fd = 0;
+		break;
+	case CG_OPERATOR_SRC_ATOP:
+		*fs = da;
+		*fd = 1 - sa;
+		break;
+	case CG_OPERATOR_DST_OVER:
+		*fs = 1 - da;
+		*fd = 1;
+		break;
+	case CG_OPERATOR_DST_ATOP:
+		*fs = 1 - da;
+		*fd = sa;
+		break;
+	case CG_OPERATOR_XOR:
+		*fs = 1 - da;
+		*fd = 1 - sa;
+		break;
+	default:
+		return 0;
+	}
+	return 1;
+}
+
+static double model_channel(enum cg_operator_t op, double s, double d, double sa, double da)
+{
+	double b;
+	switch(op)
+	{
+	case CG_OPERATOR_MULTIPLY:
+		b = s * d;
+		break;
+	case CG_OPERATOR_SCREEN:
+		return s + d - s * d;
+	case CG_OPERATOR_OVERLAY:
+		b = hard_light(d, s, da, sa);
+		break;
+	case CG_OPERATOR_DARKEN:
+		b = fmin(s * da, d * sa);
+		break;
+	case CG_OPERATOR_LIGHTEN:
+		b = fmax(s * da, d * sa);
+		break;
+	case CG_OPERATOR_COLOR_DODGE:
+		if(d == 0)
+			b = 0;
+		else if(s >= sa)
+			b = sa * da;
+		else
+			b = fmin(sa * da, d * sa * sa / (sa - s));
+		break;
+	case CG_OPERATOR_COLOR_BURN:
+		if(d >= da)
+			b = sa * da;
+		else if(s == 0)
+			b = 0;
+		else
+			b = fmax(sa * da - (da - d) * sa * sa / s, 0);
+		break;
+	case CG_OPERATOR_HARD_LIGHT:
+		b = hard_light(s, d, sa, da);
+		break;
+	case CG_OPERATOR_SOFT_LIGHT:
+		{
+			double cs = sa ? s / sa : 0;
+			double cb = da ? d / da : 0;
+			double dcb = (cb <= 0.25) ? ((16 * cb - 12) * cb + 4) * cb : sqrt(cb);
+			b = sa * da * ((cs <= 0.5) ? cb - (1 - 2 * cs) * cb * (1 - cb) : cb + (2 * cs - 1) * (dcb - cb));
+		}
+		break;
+	case CG_OPERATOR_DIFFERENCE:
+		return s + d - 2 * fmin(s * da, d * sa);
+	case CG_OPERATOR_EXCLUSION:
+		return s + d - 2 * s * d;
+	default:
+		return s;
+	}
+	return b + s * (1 - da) + d * (1 - sa);
+}
+
+static uint32_t model_pixel(enum cg_operator_t op, uint32_t s, uint32_t d, uint32_t alpha)
+{
+	double sa = ((s >> 24) & 0xff) / 255.0;
+	double da = ((d >> 24) & 0xff) / 255.0;
+	double ca = alpha / 255.0;
+	double fs, fd;
+	int pd = porter_duff(op, sa, da, &fs, &fd);
+	uint32_t r = 0;
+	for(int i = 0; i < 32; i += 8)
+	{
+		double sc = ((s >> i) & 0xff) / 255.0;
+		double dc = ((d >> i) & 0xff) / 255.0;
+		double c;
+		if(pd)
+			c = sc * fs + dc * fd;
+		else if(op == CG_OPERATOR_ADD)
+			c = fmin(sc + dc, 1);
+		else if(i == 24)
+			c = sa + da - sa * da;
+		else
+			c = model_channel(op, sc, dc, sa, da);
+		c = fmin(fmax(c, 0), 1) * ca + dc * (1 - ca);
+		r |= (uint32_t)(c * 255 + 0.5) << i;
+	}
+	return r;
+}
+
+static int pixel_distance(uint32_t a, uint32_t b)
+{
+	int m = 0;
+	for(int i = 0; i < 32; i += 8)
+	{
+		int d = abs((int)((a >> i) & 0xff) - (int)((b >> i) & 0xff));
+		if(d > m)
+			m = d;
+	}
+	return m;
+}
+
+static int simd_supported(int level)
+{
+#ifdef CG_SIMD_X86
+	__builtin_cpu_init();
+	if(level == 1)
+		return __builtin_cpu_supports("sse2");
+	if(level == 2)
+		return __builtin_cpu_supports("avx2");
+#endif
+	return level == 0;
+}
+
+int main(int argc, char * argv[])
+{
+	static const char * levels[] = { "scalar", "sse2", "avx2" };
+	static const uint32_t alphas[] = { 255, 128, 1 };
+	uint32_t src[NPIXEL], dst[NPIXEL], ref[NPIXEL], out[NPIXEL];
+	int failed = 0;
+
+	for(int i = 0; i < NPIXEL; i++)
+	{
+		src[i] = random_pixel();
+		dst[i] = random_pixel();
+	}
+	for(int k = 0; k < (int)(sizeof(kernels) / sizeof(kernels[0])); k++)
+	{
+		const struct kernel_t * kernel = &kernels[k];
+		for(int a = 0; a < (int)(sizeof(alphas) / sizeof(alphas[0])); a++)
+		{
+			uint32_t alpha = alphas[a];
+			int error = 0;
+			memcpy(ref, dst, sizeof(dst));
+			kernel->span[0](ref, NPIXEL, src, alpha);
+			for(int i = 0; i < NPIXEL; i++)
+			{
+				int d = pixel_distance(ref[i], model_pixel(kernel->op, src[i], dst[i], alpha));
+				if(d > error)
+					error = d;
+			}
+			if(error > 2)
+			{
+				printf("%s: alpha %u differs from the model by %d\n", kernel->name, alpha, error);
+				failed = 1;
+			}
+			for(int l = 1; l < 3; l++)
+			{
+				if(!kernel->span[l] || !simd_supported(l))
+					continue;
+				for(int len = 0; len <= 19; len++)
+				{
+					memcpy(out, dst, sizeof(dst));
+					kernel->span[l](out, NPIXEL - len, src, alpha);
+					if(memcmp(out, ref, (NPIXEL - len) * sizeof(uint32_t)) || memcmp(out + NPIXEL - len, dst + NPIXEL - len, len * sizeof(uint32_t)))
+					{
+						printf("%s: %s span kernel differs from scalar at alpha %u, length %d\n", kernel->name, levels[l], alpha, NPIXEL - len);
+						failed = 1;
+						break;
+					}
+				}
+			}
+			for(int c = 0; c < 16; c++)
+			{
+				uint32_t color = src[c * 61];
+				for(int i = 0; i < NPIXEL; i++)
+					out[i] = color;
+				memcpy(ref, dst, sizeof(dst));
+				kernel->span[0](ref, NPIXEL, out, alpha);
+				for(int l = 0; l < 3; l++)
+				{
+					if(!kernel->solid[l] || !simd_supported(l))
+						continue;
+					memcpy(out, dst, sizeof(dst));
+					kernel->solid[l](out, NPIXEL, color, alpha);
+					if(memcmp(out, ref, sizeof(out)))
+					{
+						printf("%s: %s solid kernel differs from the span kernel for color %08x at alpha %u\n", kernel->name, levels[l], color, alpha);
+						failed = 1;
+						break;
+					}
+				}
+			}
+		}
+	}
+	printf("blend: %s\n", failed ? "FAILED" : "ok");
+	return failed;
+}
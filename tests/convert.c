@@ -0,0 +1,141 @@
+/*
+ * Checks cg_surface_convert_from_rgba and cg_surface_convert_to_rgba:
+ * rounding against a floating point model to within one level, round
+ * trips, row strides, and the SSE2/AVX2 converters against the scalar
+ * ones bit for bit.
+ */
+#include "../src/cg.c"
+#include <stdio.h>
+
+#define NPIXEL	65536
+
+static uint32_t rgba_pixel(int i)
+{
+	uint32_t a = (uint32_t)(i >> 8);
+	uint32_t c = (uint32_t)(i & 0xff);
+	return (a << 24) | (((c * 7) & 0xff) << 16) | ((255 - c) << 8) | c;
+}
+
+static int simd_supported(int level)
+{
+#ifdef CG_SIMD_X86
+	__builtin_cpu_init();
+	if(level == 1)
+		return __builtin_cpu_supports("sse2");
+	if(level == 2)
+		return __builtin_cpu_supports("avx2");
+#endif
+	return level == 0;
+}
+
+static int check_kernel(const char * name, cg_convert_function_t kernel, cg_convert_function_t scalar, const uint32_t * src)
+{
+	static uint32_t ref[NPIXEL + 64], out[NPIXEL + 64];
+	for(int len = 0; len <= 67; len++)
+	{
+		for(int offset = 0; offset < 3; offset++)
+		{
+			memset(ref, 0xa5, sizeof(ref));
+			memset(out, 0xa5, sizeof(out));
+			scalar(ref + offset, src + len * 97, len);
+			kernel(out + offset, src + len * 97, len);
+			if(memcmp(out, ref, sizeof(out)))
+			{
+				printf("%s differs from scalar at length %d, offset %d\n", name, len, offset);
+				return 1;
+			}
+		}
+	}
+	scalar(ref, src, NPIXEL);
+	kernel(out, src, NPIXEL);
+	if(memcmp(out, ref, NPIXEL * sizeof(uint32_t)))
+	{
+		printf("%s differs from scalar on the full table\n", name);
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char * argv[])
+{
+	static uint32_t rgba[NPIXEL], back[NPIXEL], argb[NPIXEL], again[NPIXEL];
+	struct cg_surface_t * surface = cg_surface_create(256, 256);
+	int failed = 0;
+
+	for(int i = 0; i < NPIXEL; i++)
+		rgba[i] = rgba_pixel(i);
+	cg_surface_convert_from_rgba(surface, rgba, 256 * 4);
+	memcpy(argb, surface->pixels, sizeof(argb));
+	cg_surface_convert_to_rgba(surface, back, 256 * 4);
+	cg_surface_convert_from_rgba(surface, back, 256 * 4);
+	memcpy(again, surface->pixels, sizeof(again));
+	for(int i = 0; i < NPIXEL && !failed; i++)
+	{
+		uint32_t a = rgba[i] >> 24;
+		for(int c = 0; c < 3; c++)
+		{
+			uint32_t s = (rgba[i] >> (c * 8)) & 0xff;
+			uint32_t p = (argb[i] >> ((2 - c) * 8)) & 0xff;
+			uint32_t u = (back[i] >> (c * 8)) & 0xff;
+			if(fabs(p - s * a / 255.0) >= 1.0)
+			{
+				printf("from_rgba: %08x premultiplies to %08x\n", rgba[i], argb[i]);
+				failed = 1;
+				break;
+			}
+			if(a && fabs(u - p * 255.0 / a) >= 1.0)
+			{
+				printf("to_rgba: %08x unpremultiplies to %08x\n", argb[i], back[i]);
+				failed = 1;
+				break;
+			}
+		}
+		if((argb[i] >> 24) != a || (a == 0 && argb[i] != 0))
+		{
+			printf("from_rgba: %08x has the wrong alpha in %08x\n", rgba[i], argb[i]);
+			failed = 1;
+		}
+		if((a == 255) && (back[i] != rgba[i]))
+		{
+			printf("opaque pixel %08x does not round trip: %08x\n", rgba[i], back[i]);
+			failed = 1;
+		}
+		if(again[i] != argb[i])
+		{
+			printf("premultiplied pixel %08x changes after a round trip: %08x\n", argb[i], again[i]);
+			failed = 1;
+		}
+	}
+
+	struct cg_surface_t * small = cg_surface_create(5, 3);
+	uint8_t padded[3][5 * 4 + 12];
+	memset(padded, 0x5a, sizeof(padded));
+	cg_surface_convert_to_rgba(small, padded, 5 * 4 + 12);
+	for(int y = 0; y < 3; y++)
+	{
+		for(int x = 5 * 4; x < 5 * 4 + 12; x++)
+		{
+			if(padded[y][x] != 0x5a)
+			{
+				printf("to_rgba wrote past the row width at row %d\n", y);
+				failed = 1;
+				y = 3;
+				break;
+			}
+		}
+	}
+	cg_surface_destroy(small);
+	cg_surface_destroy(surface);
+
+#ifdef CG_SIMD_X86
+	if(simd_supported(1))
+		failed |= check_kernel("from_rgba sse2", cg_convert_from_rgba_sse2, __cg_convert_from_rgba, rgba);
+	if(simd_supported(2))
+	{
+		failed |= check_kernel("from_rgba avx2", cg_convert_from_rgba_avx2, __cg_convert_from_rgba, rgba);
+		failed |= check_kernel("to_rgba avx2", cg_convert_to_rgba_avx2, __cg_convert_to_rgba, argb);
+	}
+#endif
+	printf("convert: %s\n", failed ? "FAILED" : "ok");
+	return failed;
+}
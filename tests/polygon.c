@@ -0,0 +1,91 @@
+/*
+ * Checks fills and clips of straight-edged paths: a path that starts with
+ * cg_line_to renders like the same path started with cg_move_to, and
+ * recorded drawing matches direct drawing.
+ */
+#include <cg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define WIDTH	64
+#define HEIGHT	64
+
+static void draw(struct cg_ctx_t * ctx, int move, int clip)
+{
+	cg_set_source_rgb(ctx, 0, 0, 0);
+	if(move)
+		cg_move_to(ctx, 5.3, 4.7);
+	else
+		cg_line_to(ctx, 5.3, 4.7);
+	cg_line_to(ctx, 58.6, 20.2);
+	cg_line_to(ctx, 20.4, 60.1);
+	if(clip)
+	{
+		cg_clip(ctx);
+		cg_paint(ctx);
+	}
+	else
+		cg_fill(ctx);
+}
+
+static struct cg_surface_t * render(int move, int clip, int recorded)
+{
+	struct cg_surface_t * surface = cg_surface_create(WIDTH, HEIGHT);
+	struct cg_ctx_t * ctx = cg_create(surface);
+	if(recorded)
+	{
+		cg_begin_recording(ctx);
+		draw(ctx, move, clip);
+		struct cg_display_list_t * list = cg_end_recording(ctx);
+		cg_display_list_replay(ctx, list);
+		cg_display_list_destroy(list);
+	}
+	else
+		draw(ctx, move, clip);
+	cg_destroy(ctx);
+	return surface;
+}
+
+static int covered(struct cg_surface_t * surface)
+{
+	uint32_t * pixels = surface->pixels;
+	int n = 0;
+	for(int i = 0; i < WIDTH * HEIGHT; i++)
+	{
+		if(pixels[i] >> 24)
+			n++;
+	}
+	return n;
+}
+
+int main(int argc, char * argv[])
+{
+	static const char * names[] = { "fill", "clip" };
+	int failed = 0;
+
+	for(int clip = 0; clip < 2; clip++)
+	{
+		struct cg_surface_t * expect = render(1, clip, 0);
+		if(covered(expect) < 1000)
+		{
+			printf("%s with cg_move_to covers only %d pixels\n", names[clip], covered(expect));
+			failed = 1;
+		}
+		for(int recorded = 0; recorded < 2; recorded++)
+		{
+			for(int move = 0; move < 2; move++)
+			{
+				struct cg_surface_t * surface = render(move, clip, recorded);
+				if(memcmp(surface->pixels, expect->pixels, (size_t)(expect->stride * expect->height)))
+				{
+					printf("%s%s%s differs from direct drawing with cg_move_to\n", recorded ? "recorded " : "", names[clip], move ? "" : " without cg_move_to");
+					failed = 1;
+				}
+				cg_surface_destroy(surface);
+			}
+		}
+		cg_surface_destroy(expect);
+	}
+	printf("polygon: %s\n", failed ? "FAILED" : "ok");
+	return failed;
+}
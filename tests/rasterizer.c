@@ -0,0 +1,85 @@
+/*
+ * Checks that CG_RASTERIZER_ACCUMULATE produces the same pixels as the
+ * default cell rasterizer for fills, strokes and clips.
+ */
+#include <cg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define WIDTH	320
+#define HEIGHT	240
+
+static unsigned int seed = 1;
+
+static double random_unit(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return ((seed >> 16) & 0x7fff) / 32767.0;
+}
+
+static void draw(struct cg_ctx_t * ctx)
+{
+	seed = 1;
+	cg_set_source_rgb(ctx, 1, 1, 1);
+	cg_paint(ctx);
+	cg_save(ctx);
+	cg_arc(ctx, 160.3, 120.6, 100.2, 0, 2 * M_PI);
+	cg_clip(ctx);
+	cg_set_fill_rule(ctx, CG_FILL_RULE_EVEN_ODD);
+	cg_set_source_rgba(ctx, 0.9, 0.5, 0.1, 0.8);
+	cg_move_to(ctx, 160, 120);
+	for(int i = 0; i < 200; i++)
+		cg_line_to(ctx, random_unit() * WIDTH, random_unit() * HEIGHT);
+	cg_close_path(ctx);
+	cg_fill(ctx);
+	cg_restore(ctx);
+	cg_set_fill_rule(ctx, CG_FILL_RULE_NON_ZERO);
+	cg_set_source_rgba(ctx, 0.1, 0.4, 0.9, 0.6);
+	for(int i = 0; i < 20; i++)
+	{
+		double x = random_unit() * WIDTH, y = random_unit() * HEIGHT;
+		cg_move_to(ctx, x, y);
+		cg_curve_to(ctx, x + random_unit() * 80 - 40, y + random_unit() * 80 - 40, x + random_unit() * 80 - 40, y + random_unit() * 80 - 40, x + random_unit() * 80 - 40, y + random_unit() * 80 - 40);
+		cg_close_path(ctx);
+	}
+	cg_fill(ctx);
+	cg_set_source_rgba(ctx, 0, 0, 0, 0.7);
+	cg_set_line_width(ctx, 4.7);
+	cg_set_line_join(ctx, CG_LINE_JOIN_ROUND);
+	cg_move_to(ctx, -20.5, 200.3);
+	for(int i = 0; i < 40; i++)
+		cg_line_to(ctx, i * 9.1, 200.3 - random_unit() * 60);
+	cg_stroke(ctx);
+}
+
+static struct cg_surface_t * render(enum cg_rasterizer_t rasterizer, int threads)
+{
+	struct cg_surface_t * surface = cg_surface_create(WIDTH, HEIGHT);
+	struct cg_ctx_t * ctx = cg_create(surface);
+	cg_set_rasterizer(ctx, rasterizer);
+	if(threads > 1)
+		cg_set_threads(ctx, threads);
+	draw(ctx);
+	cg_destroy(ctx);
+	return surface;
+}
+
+int main(int argc, char * argv[])
+{
+	struct cg_surface_t * cell = render(CG_RASTERIZER_CELL, 1);
+	int failed = 0;
+
+	for(int threads = 1; threads <= 4; threads += 3)
+	{
+		struct cg_surface_t * accum = render(CG_RASTERIZER_ACCUMULATE, threads);
+		if(memcmp(accum->pixels, cell->pixels, (size_t)(cell->stride * cell->height)))
+		{
+			printf("accumulation rasterizer with %d thread(s) differs from the cell rasterizer\n", threads);
+			failed = 1;
+		}
+		cg_surface_destroy(accum);
+	}
+	cg_surface_destroy(cell);
+	printf("rasterizer: %s\n", failed ? "FAILED" : "ok");
+	return failed;
+}
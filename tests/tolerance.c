@@ -0,0 +1,98 @@
+/*
+ * Checks cg_set_tolerance on hairline and dashed circles: covered pixels
+ * stay within the tolerance of the true curve, the value changes the
+ * flattening, and zero, negative or NaN values are clamped to 0.001.
+ */
+#include <cg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SIZE	200
+
+static const double cx = 100.3, cy = 100.6, radius = 80.2;
+
+static struct cg_surface_t * render(double tolerance, int dashed)
+{
+	struct cg_surface_t * surface = cg_surface_create(SIZE, SIZE);
+	struct cg_ctx_t * ctx = cg_create(surface);
+	static double dashes[] = { 9.0, 3.0 };
+	cg_set_tolerance(ctx, tolerance);
+	cg_set_source_rgb(ctx, 0, 0, 0);
+	cg_set_line_width(ctx, dashed ? 4.0 : 1.0);
+	if(dashed)
+		cg_set_dash(ctx, dashes, 2, 0);
+	cg_arc(ctx, cx, cy, radius, 0, 2 * M_PI);
+	cg_stroke(ctx);
+	cg_destroy(ctx);
+	return surface;
+}
+
+/* Largest distance from the circle of any covered pixel center */
+static double spread(struct cg_surface_t * surface)
+{
+	uint32_t * pixels = surface->pixels;
+	double m = 0;
+	for(int y = 0; y < SIZE; y++)
+	{
+		for(int x = 0; x < SIZE; x++)
+		{
+			if(pixels[y * SIZE + x] >> 24)
+			{
+				double d = fabs(sqrt((x + 0.5 - cx) * (x + 0.5 - cx) + (y + 0.5 - cy) * (y + 0.5 - cy)) - radius);
+				if(d > m)
+					m = d;
+			}
+		}
+	}
+	return m;
+}
+
+static int same(struct cg_surface_t * a, struct cg_surface_t * b)
+{
+	return memcmp(a->pixels, b->pixels, (size_t)(a->stride * a->height)) == 0;
+}
+
+int main(int argc, char * argv[])
+{
+	static const double tolerances[] = { 0.01, 3.0 };
+	static const double invalid[] = { 0.0, -1.0, NAN };
+	int failed = 0;
+
+	for(int dashed = 0; dashed < 2; dashed++)
+	{
+		const char * name = dashed ? "dashed" : "hairline";
+		double width = dashed ? 4.0 : 1.0;
+		struct cg_surface_t * fine = render(tolerances[0], dashed);
+		struct cg_surface_t * coarse = render(tolerances[1], dashed);
+		struct cg_surface_t * clamped = render(0.001, dashed);
+		for(int i = 0; i < 2; i++)
+		{
+			double m = spread(i ? coarse : fine);
+			if(m > width * 0.5 + tolerances[i] + 0.75)
+			{
+				printf("%s circle at tolerance %g covers a pixel %g from the curve\n", name, tolerances[i], m);
+				failed = 1;
+			}
+		}
+		if(same(fine, coarse))
+		{
+			printf("%s circle does not change with the tolerance\n", name);
+			failed = 1;
+		}
+		for(int i = 0; i < 3; i++)
+		{
+			struct cg_surface_t * surface = render(invalid[i], dashed);
+			if(!same(surface, clamped))
+			{
+				printf("%s circle at tolerance %g is not clamped to 0.001\n", name, invalid[i]);
+				failed = 1;
+			}
+			cg_surface_destroy(surface);
+		}
+		cg_surface_destroy(fine);
+		cg_surface_destroy(coarse);
+		cg_surface_destroy(clamped);
+	}
+	printf("tolerance: %s\n", failed ? "FAILED" : "ok");
+	return failed;
+}